@@ -11,9 +11,21 @@
  *  3  MPI_Allreduce is used to combine the partial results
  *
  *  NOTE: steps 2-3 are repeated as many times as requested (numiterations)
+ *
+ *  With -d the processors sum numints doubles in total instead, each its
+ *  own block.  Element i only depends on i, and the sum is computed twice:
+ *  - plain: local sums of doubles combined by MPI_Allreduce (MPI_SUM);
+ *    the result changes with the number of processors
+ *  - reproducible: every element is cut into two 64-bit integer bins on
+ *    a grid fixed by max |x| (one MPI_Allreduce with MPI_MAX) and numints;
+ *    integer sums are exact, so the bins combined by MPI_Allreduce give
+ *    the same bits for any number of processors (binned summation)
  *---------------------------------------------------------*/
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
 #include <sys/resource.h>
 #include <sys/time.h>
@@ -68,6 +80,54 @@ long p_summation(vector<int>& memory) {
   return result.get_sum();
 }
 
+/*==============================================================
+ * p_random_double (element i of the -d sequence, the same for any
+ *                  number of processors: SplitMix64 of i, in
+ *                  [-1,1) times a power of ten in [1e-8, 1e8])
+ *==============================================================*/
+double p_random_double(uint64_t i) {
+  uint64_t z = (i + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z = z ^ (z >> 31);
+  double u = (double)(z >> 11) * (1.0 / 4503599627370496.0) - 1.0;
+  return u * pow(10.0, (int)(z % 17) - 8);
+}
+
+/*==============================================================
+ * p_binned_sum (reproducible sum of the doubles of all
+ *               processors; see assign2/scan/reproducible.h)
+ *==============================================================*/
+double p_binned_sum(const vector<double>& memory, long numints, MPI_Comm comm) {
+
+  /* the grid: max |x| < 2^e, numints <= 2^k */
+  double local_max = 0, max_abs = 0;
+  for (size_t i = 0; i < memory.size(); ++i) local_max = max(local_max, fabs(memory[i]));
+  MPI_Allreduce(&local_max, &max_abs, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+  int e = 0, k = 0;
+  frexp(max_abs, &e);
+  while (k < 62 && (1L << k) < numints) ++k;
+  int s1 = 62 - k - e, s2 = 61 - k;
+
+  /* x * 2^s1 = hi + r, r * 2^s2 ~ lo; no sum of numints bins exceeds 2^62 */
+  bool normal = s1 >= -1022 && s1 <= 1023;
+  double scale1 = normal ? ldexp(1.0, s1) : 0.0, scale2 = ldexp(1.0, s2);
+  int64_t bins[2] = { 0, 0 }, total_bins[2];
+  for (size_t i = 0; i < memory.size(); ++i) {
+    double t = normal ? memory[i] * scale1 : ldexp(memory[i], s1);
+    int64_t hi = (int64_t)t;
+    bins[0] += hi;
+    bins[1] += (int64_t)((t - (double)hi) * scale2);
+  }
+
+  /* integer sums are exact, in any order */
+  MPI_Allreduce(bins, total_bins, 2, MPI_INT64_T, MPI_SUM, comm);
+
+  long double v = (long double)total_bins[0] * ldexpl(1.0L, s2) + (long double)total_bins[1];
+  return (double)ldexpl(v, -(s1 + s2));
+}
+
 /*==============================================================
  * print_elapsed (prints timing statistics)
  *==============================================================*/
@@ -87,6 +147,61 @@ long p_summation(vector<int>& memory) {
     desc, (elapsed.tv_sec*1000000 + elapsed.tv_usec) / niters);
 }
 
+/*==============================================================
+ * elapsed_usec (elapsed time between start and end)
+ *==============================================================*/
+long elapsed_usec(struct timeval* start, struct timeval* end) {
+
+  return (end->tv_sec - start->tv_sec) * 1000000L + (end->tv_usec - start->tv_usec);
+}
+
+/*==============================================================
+ * p_sum_doubles (-d: plain and reproducible sums of numints
+ *                doubles split across the processors)
+ *==============================================================*/
+void p_sum_doubles(long numints, int numiterations, int my_id, int nprocs) {
+
+  struct timeval start, end;  /* gettimeofday stuff */
+  struct timezone tzp;
+
+  /* this processor's block of the sequence */
+  long first = numints * my_id / nprocs;
+  long last = numints * (my_id + 1) / nprocs;
+  vector<double> mymemory(last - first);
+  for (long i = first; i < last; ++i) mymemory[i - first] = p_random_double(i);
+
+  double plain_sum = 0, binned_sum = 0;
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  gettimeofday(&start, &tzp);
+  for (int iteration = 0; iteration < numiterations; iteration++) {
+
+    double sum = 0;
+    for (size_t i = 0; i < mymemory.size(); ++i) sum += mymemory[i];
+    MPI_Allreduce(&sum, &plain_sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  }
+  gettimeofday(&end, &tzp);
+  long plain_usec = elapsed_usec(&start, &end) / numiterations;
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  gettimeofday(&start, &tzp);
+  for (int iteration = 0; iteration < numiterations; iteration++) {
+
+    binned_sum = p_binned_sum(mymemory, numints, MPI_COMM_WORLD);
+  }
+  gettimeofday(&end, &tzp);
+  long binned_usec = elapsed_usec(&start, &end) / numiterations;
+
+  if(my_id == 0) {
+
+    printf("\n Plain summation total elapsed time = %ld (usec)", plain_usec);
+    printf("\n Reproducible summation total elapsed time = %ld (usec), %.2fx plain",
+           binned_usec, plain_usec > 0 ? binned_usec / (double)plain_usec : 0.0);
+    printf("\n Plain sum = %.17g (%a)", plain_sum, plain_sum);
+    printf("\n Reproducible sum = %.17g (%a)\n", binned_sum, binned_sum);
+  }
+}
+
 /*==============================================================
  *  Main Program (Parallel Summation)
  *==============================================================*/
@@ -126,7 +241,7 @@ int main(int argc, char **argv) {
   if(argc < 3) {
 
     if(my_id == 0)
-      printf("Usage: %s [numints] [numiterations]\n\n", argv[0]);
+      printf("Usage: %s [numints] [numiterations] [-d]\n\n", argv[0]);
 
     MPI_Finalize();
     exit(1);
@@ -137,6 +252,18 @@ int main(int argc, char **argv) {
 
   MPI_Comm_size(MPI_COMM_WORLD, &nprocs); /* Get number of processors */
 
+  /* -d: numints doubles in total, summed plainly and reproducibly */
+  if(argc > 3 && strcmp(argv[3], "-d") == 0) {
+
+    if(my_id == 0)
+      printf("\nExecuting %s: nprocs=%d, numints=%d (doubles in total), numiterations=%d\n",
+              argv[0], nprocs, numints, numiterations);
+
+    p_sum_doubles(numints, numiterations, my_id, nprocs);
+    MPI_Finalize();
+    return 0;
+  }
+
   if(my_id == 0)
     printf("\nExecuting %s: nprocs=%d, numints=%d, numiterations=%d\n",
             argv[0], nprocs, numints, numiterations);
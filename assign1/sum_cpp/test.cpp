@@ -8,8 +8,8 @@ using namespace std;
 // prefix scan function
 template <typename Iter, typename Func, typename T>
 inline void scanl(Iter start, Iter end, Func f, T init) {
-  T acc = 0;
-  while( start <= end ) {
+  T acc = init;
+  while( start != end ) {
     acc = f(acc, *start);
     *start = acc;    
     ++start;
@@ -18,7 +18,7 @@ inline void scanl(Iter start, Iter end, Func f, T init) {
 
 template <typename Iter, typename Func>
 inline void map(Iter start, Iter end, Func f) {
-  while( start <= end ) {
+  while( start != end ) {
     f(*start);
     ++start;
   }
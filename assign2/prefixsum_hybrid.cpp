@@ -0,0 +1,274 @@
+/*
+ *  prefixsum_hybrid.cpp - Demonstrates parallelism via random fill and prefix
+ *  sum routines.
+ *  This program uses MPI and OpenMP (one process per node, one thread per core).
+ */
+
+/*---------------------------------------------------------
+ *  Parallel Prefix Sum
+ *
+ *  1. Processor 0 generates numints random integers
+ *  2. Processor 0 distributes the integers to all processors (MPI_Scatterv)
+ *     The integers are stored and sent as int32 and summed into longs, so
+ *     the scatter moves half the bytes of a long input.
+ *     With -g, steps 1-2 are replaced by every processor generating its own
+ *     slice, so the whole sequence is never held by a single processor.
+ *  3. Prefix sums are computed by the hybrid backend of scan/hybrid.h:
+ *     the threads of each processor scan its slice and add back its offset,
+ *     and only one value per processor is exchanged
+ *     (offset exchange selected by -x: linear, exscan, rd or all),
+ *     inclusive or with -e exclusive; every processor also gets the total
+ *
+ *  4. Processor 0 collects the prefix sums (MPI_Gatherv), unless -n keeps
+ *     them distributed; then every processor verifies its own slice.
+ *
+ *  NOTE: steps 2-3 are repeated as many times as requested (numiterations)
+ *  With -T file, the phases of every thread of every process are timed
+ *  (scan/timer.h) and processor 0 writes their min/mean/max and imbalance
+ *  as CSV to file, or to stdout for -T -.
+ *---------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <mpi.h>
+#include <omp.h>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <climits>
+#include "scan/hybrid.h"
+#include "scan/mpi_driver.h"
+#include "scan/random.h"
+
+using namespace std;
+
+/*==============================================================
+ * p_generate_random_ints (processor-wise generation of random ints)
+ *==============================================================*/
+void p_generate_random_ints(vector<int>& memory, uint64_t seed, long first_index, long n,
+                            int nthreads) {
+  /* generate & write this processor's random integers, one block per thread */
+  memory.resize(n);
+#pragma omp parallel num_threads(nthreads)
+  {
+    long pos0, pos1;
+    scan::block_range(n, omp_get_num_threads(), omp_get_thread_num(), &pos0, &pos1);
+    if( pos0 < pos1 )
+      scan::random_ints(seed, first_index + pos0, &memory[pos0], pos1 - pos0);
+  }
+}
+
+/*==============================================================
+ *  Main Program (Parallel Summation)
+ *==============================================================*/
+int main(int argc, char **argv) {
+
+  int nprocs, nthreads, numiterations; /* command line args */
+  long numints, numints_per_proc;
+  bool write_outputs = false;
+  uint64_t seed = 1;           /* -s: seed of the counter-based input generator */
+  bool gather_results = true;  /* -n keeps the results distributed */
+  bool local_input = false;    /* -g: every process generates its own slice */
+  bool exclusive = false;      /* -e: exclusive prefix sums */
+  long total = 0;              /* total of the sequence, known to every process */
+  scan::openmp::algorithm_t algorithm = scan::openmp::scan_then_propagate;  /* -a: in-process scan */
+  vector<scan::mpi::exchange_t> exchanges; /* offset exchange strategies to time */
+  vector<double> exchange_times;
+  const char* timers_file = NULL;  /* -T: CSV report of the phase timers */
+
+  int my_id;
+
+  vector<int> gmemory;   /* vector to store the input sequence (int32, like rand()) */
+  vector<long> results;  /* vector to store the results */
+  vector<long> mymemory; /* Vector to store processes numbers */
+  vector<int> myinput;   /* this process' input slice */
+
+  struct timeval gen_start, gen_end; /* gettimeofday stuff */
+  struct timezone tzp;
+
+  /*---------------------------------------------------------
+   * Initializing the MPI environment
+   * "nprocs" copies of this program will be initiated by MPI.
+   * All the variables will be private, only the program owner could see its own variables
+   * If there must be a inter-procesor communication, the communication must be
+   * done explicitly using MPI communication functions.
+   *---------------------------------------------------------*/
+
+  /* only the main thread calls MPI, outside of parallel regions */
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  MPI_Comm_rank(MPI_COMM_WORLD, &my_id); /* Getting the ID for this process */
+
+  /*---------------------------------------------------------
+   *  Read Command Line
+   *  - check usage and parse args
+   *---------------------------------------------------------*/
+
+  if(argc < 4) {
+
+    if(my_id == 0)
+      printf("Usage: %s [numthreads] [numints] [numiterations] [-o] [-n] [-g] [-e] [-s seed] [-x linear|exscan|rd|all] [-a algorithm] [-T file|-]\n\n", argv[0]);
+
+    MPI_Finalize();
+    exit(1);
+  }
+
+  nthreads      = atoi(argv[1]);
+  numints       = atol(argv[2]);
+  numiterations = atoi(argv[3]);
+  if( nthreads <= 0 ) nthreads = omp_get_max_threads();
+
+  for(int i=4;i<argc;++i) {
+    string arg(argv[i]);
+    if( arg == "-o" ) {
+      write_outputs = true;
+    }
+    else if( arg == "-n" ) {
+      gather_results = false;
+    }
+    else if( arg == "-g" ) {
+      local_input = true;
+      gather_results = false;  /* process 0 never holds the whole sequence */
+    }
+    else if( arg == "-e" ) {
+      exclusive = true;
+    }
+    else if( arg == "-T" && i+1 < argc ) {
+      timers_file = argv[++i];
+      scan::timers_enable();
+    }
+    else if( arg == "-s" && i+1 < argc ) {
+      seed = strtoull(argv[++i], NULL, 10);
+    }
+    else if( arg == "-a" && i+1 < argc ) {
+      if( !scan::parse_algorithm(argv[++i], &algorithm) ) {
+        if(my_id == 0)
+          printf("Unknown algorithm %s\n\n", argv[i]);
+
+        MPI_Finalize();
+        exit(1);
+      }
+    }
+    else if( arg == "-x" && i+1 < argc ) {
+      scan::mpi::exchange_t exchange;
+      if( string(argv[++i]) == "all" ) {
+        exchanges.push_back(scan::mpi::linear);
+        exchanges.push_back(scan::mpi::exscan);
+        exchanges.push_back(scan::mpi::recursive_doubling);
+      }
+      else if( scan::parse_exchange(argv[i], &exchange) ) {
+        exchanges.push_back(exchange);
+      }
+    }
+  }
+  if( exchanges.empty() ) exchanges.push_back(scan::mpi::exscan);
+
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs); /* Get number of processors */
+
+  /* MPI_Scatterv/MPI_Gatherv take int counts and displacements */
+  if( !local_input && numints > INT_MAX ) {
+    if(my_id == 0)
+      printf("numints=%ld needs -g (rank-local input generation)\n\n", numints);
+
+    MPI_Finalize();
+    exit(1);
+  }
+
+  /* Balanced partition: slice sizes differ by at most one element */
+  long myint_first, myint_last;
+  scan::block_range(numints, nprocs, my_id, &myint_first, &myint_last);
+  long mynumints = myint_last - myint_first;
+  numints_per_proc = numints / nprocs + (numints % nprocs ? 1 : 0);
+
+  vector<int> counts, displs;  /* empty: nothing is scattered or gathered */
+  if( !local_input ) scan::slice_layout(numints, nprocs, counts, displs);
+
+  if(my_id == 0) {
+    printf("\nExecuting %s: nprocs=%d, nthreads=%d, numints=%ld, numints_per_proc=%ld, numiterations=%d, seed=%llu, algorithm=%s%s\n",
+           argv[0], nprocs, nthreads, numints, numints_per_proc, numiterations, (unsigned long long)seed,
+           scan::algorithm_name(algorithm), local_input ? ", input=local" : "");
+    if( provided < MPI_THREAD_FUNNELED )
+      printf("Warning: the MPI library does not support MPI_THREAD_FUNNELED\n");
+  }
+
+  /*---------------------------------------------------------
+   *  Initialization
+   *  - allocate memory for work area structures and work area
+   *---------------------------------------------------------*/
+  if( local_input ) {
+    /* every process generates its own slice, nothing is sent */
+    gettimeofday(&gen_start, &tzp);
+    p_generate_random_ints(myinput, seed, myint_first, mynumints, nthreads);
+    gettimeofday(&gen_end, &tzp);
+    if( my_id == 0 )
+      scan::print_elapsed("Input generated", &gen_start, &gen_end, 1);
+  }
+  else if( my_id == 0 ) {
+    if( gather_results ) results.resize(numints);
+    /* get starting time */
+    gettimeofday(&gen_start, &tzp);
+    p_generate_random_ints(gmemory, seed, 0, numints, nthreads);  /* counter-based fill */
+    gettimeofday(&gen_end, &tzp);
+    scan::print_elapsed("Input generated", &gen_start, &gen_end, 1);
+  }
+
+  if( !local_input ) myinput.resize(mynumints);
+  mymemory.resize(mynumints);
+
+  long scatterTime = 0;
+  long gatherTime = 0;
+
+  MPI_Barrier(MPI_COMM_WORLD); /* Global barrier */
+
+  /* time every requested offset exchange strategy */
+  for(size_t x = 0; x < exchanges.size(); x++) {
+    scan::hybrid policy(scan::mpi(MPI_COMM_WORLD, exchanges[x]), scan::openmp(nthreads, algorithm));
+    exchange_times.push_back(scan::time_scans(policy, MPI_COMM_WORLD, gmemory, counts, displs,
+                                              myinput, mymemory, exclusive, numiterations,
+                                              &scatterTime, &total));
+  }
+
+  bool passed = false;
+  if( gather_results )
+    /* Pass the results back to master */
+    gatherTime = scan::gather_slices(MPI_COMM_WORLD, mymemory, results, counts, displs);
+  else
+    /* Results stay distributed: every process checks its own slice */
+    passed = scan::verify_distributed(myinput, mymemory, exclusive, total, MPI_COMM_WORLD);
+
+  if( my_id == 0 ) {
+    std::cout << std::endl;
+    for(size_t x=0;x<exchanges.size();++x) {
+      std::cout << "Total elapsed time (exchange=" << scan::exchange_name(exchanges[x]) << ") = "
+                << exchange_times[x] << " (usec)" << std::endl;
+    }
+    if( !local_input )
+      std::cout << "Scatter elapsed time = "
+                << scatterTime / (double)(numiterations * exchanges.size()) << " (usec)" << std::endl;
+    if( gather_results )
+      std::cout << "Gather elapsed time = " << gatherTime << " (usec)" << std::endl;
+    std::cout << "Total = " << total << std::endl;
+    std::cout << std::endl;
+
+    if( !gather_results )
+      std::cout << (passed ? "PASSED." : "FAILED.") << std::endl;
+    else
+      scan::report_gathered(gmemory, results, exclusive, total, write_outputs);
+  }
+
+  /* phases of all iterations of every strategy timed above */
+  if( timers_file )
+    scan::write_phase_report(MPI_COMM_WORLD, timers_file, numiterations * exchanges.size());
+
+  /*---------------------------------------------------------
+   *  Cleanup
+   *---------------------------------------------------------*/
+
+  MPI_Finalize();
+
+  return 0;
+} /* main() */
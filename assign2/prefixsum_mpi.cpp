@@ -8,20 +8,41 @@
  *  Parallel Prefix Sum
  *
  *  1. Processor 0 generates numints random integers
- *  2. Processor 0 distributes the integers to all processors
- *  3. Prefix sums:
- *  3.1 Each processor computes prefix sums of his numints random integers (in parallel)
- *  3.2 All the processes send the last element of their prefix sums to Processor 0
- *  3.3 Processor 0 receives the partial sums from all the other processes.
- *  3.3 Processor 0 computes prefix sums of the partial sums (sequentially)
- *  3.4 Processor 0 sends the result to all other processors
- *  3.5 All processors add the received number to local prefix sums.
+ *  2. Processor 0 distributes the integers to all processors (MPI_Scatterv)
+ *     The integers are stored and sent as int32 and summed into longs, so
+ *     the scatter moves half the bytes of a long input.
+ *     With -p chunk, steps 2-3 are pipelined instead: the slices are sent
+ *     in sub-chunks of chunk ints with MPI_Isend/MPI_Irecv and every
+ *     sub-chunk is scanned as it lands (scan/mpi_pipeline.h).
+ *     With -g, steps 1-2 are replaced by every processor generating its own
+ *     slice, so the whole sequence is never held by a single processor.
+ *     With -i file, every processor reads its own slice of a binary file of
+ *     longs instead (collective MPI-IO, scan/mpi_io.h).
+ *  3. Prefix sums are computed by the MPI backend of scan/mpi.h
+ *     (offset exchange selected by -x: linear, exscan, rd or all),
+ *     inclusive or with -e exclusive; every processor also gets the total
  *
- *  NOTE: steps 3 are repeated as many times as requested (numiterations)
+ *  4. Processor 0 collects the prefix sums (MPI_Gatherv), unless -n keeps
+ *     them distributed; then every processor verifies its own slice.
+ *     With -w file, every processor writes its slice of the prefix sums to
+ *     the binary file (collective MPI-IO).
+ *
+ *  NOTE: steps 2-3 are repeated as many times as requested (numiterations)
+ *  With -P, steps 2-3 are then repeated again with persistent requests
+ *  (scan/mpi_persistent.h) and no barrier between iterations, and the
+ *  latencies per iteration of both recursive doubling loops are compared
+ *  (-P adds rd to the exchanges timed by -x).
+ *  With -S seglen, segmented prefix sums (scan/segmented.h) of the generated
+ *  input are checked over the same slices, inclusive and exclusive, with
+ *  segments every seglen ints, one per slice, and one in all.
+ *  With -T file, the phases of every process are timed (scan/timer.h) and
+ *  processor 0 writes their min/mean/max and imbalance as CSV to file, or
+ *  to stdout for -T -.
  *---------------------------------------------------------*/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <sys/resource.h>
 #include <sys/time.h>
@@ -29,50 +50,142 @@
 #include <vector>
 #include <algorithm>
 #include <iostream>
-#include <cmath>
-#include <iostream>
-#include <iterator>
 #include <numeric>
+#include <climits>
+#include "scan/mpi.h"
+#include "scan/mpi_driver.h"
+#include "scan/mpi_io.h"
+#include "scan/mpi_pipeline.h"
+#include "scan/mpi_persistent.h"
+#include "scan/random.h"
+#include "scan/segmented.h"
 
 using namespace std;
 
 /*==============================================================
  * p_generate_random_ints (processor-wise generation of random ints)
  *==============================================================*/
-void p_generate_random_ints(vector<long>& memory, int n) {
+void p_generate_random_ints(vector<int>& memory, uint64_t seed, long first_index, long n) {
   /* generate & write this processor's random integers */
-  for (int i = 0; i < n; ++i) {
-    memory.push_back(rand());
-  }
+  memory.resize(n);
+  scan::random_ints(seed, first_index, memory.data(), n);
 }
 
-void p_prefix_sum(vector<long>& memory) {
-  for(int i=1;i<memory.size();++i) {
-    memory[i]+=memory[i-1];
+/*==============================================================
+ * p_verify_segmented (checks the inclusive and exclusive segmented
+ *   prefix sums of the ints generated from seed, in the slices
+ *   [first_index,first_index+n), with segments every seglen ints,
+ *   one segment per slice, and one segment in all; true on all
+ *   ranks iff every check passes)
+ *==============================================================*/
+bool p_verify_segmented(const scan::mpi& policy, uint64_t seed, long first_index, long n,
+                        long seglen) {
+  vector<int> input;
+  p_generate_random_ints(input, seed, first_index, n);
+  long local_sum = std::accumulate(input.begin(), input.end(), 0L);
+  long offset = 0;
+  MPI_Exscan(&local_sum, &offset, 1, MPI_LONG, MPI_SUM, policy.comm);
+  if( first_index == 0 ) offset = 0;
+
+  int passed = 1;
+  vector<long> prefix_sums(n);
+  for(int layout=0;layout<3;++layout) {
+    /* heads of the slice (as offsets into it), and the sum of the ints
+       of the slice's first segment that precede the slice */
+    vector<long> heads;
+    long lead = 0;
+    if( layout == 0 ) {
+      long head = first_index - first_index % seglen;
+      for(long pos=(head < first_index ? head + seglen : head) - first_index;pos<n;pos+=seglen)
+        heads.push_back(pos);
+      vector<int> preceding;
+      p_generate_random_ints(preceding, seed, head, first_index - head);
+      lead = std::accumulate(preceding.begin(), preceding.end(), 0L);
+    }
+    else if( layout == 1 ) {
+      heads.push_back(0);
+    }
+    else {
+      lead = offset;
+    }
+    vector<unsigned char> flags = scan::detail::offsets_to_flags(heads.begin(), heads.end(), n);
+
+    for(int exclusive=0;exclusive<2;++exclusive) {
+      if( exclusive )
+        scan::segmented_exclusive_scan(policy, input.begin(), input.end(), heads.begin(),
+                                       heads.end(), prefix_sums.begin(), std::plus<long>(), 0L);
+      else
+        scan::segmented_inclusive_scan(policy, input.begin(), input.end(), flags.begin(),
+                                       prefix_sums.begin(), std::plus<long>(), 0L);
+
+      long acc = lead;
+      for(long i=0;i<n;++i) {
+        if( flags[i] ) acc = 0;
+        if( exclusive && prefix_sums[i] != acc ) passed = 0;
+        acc += input[i];
+        if( !exclusive && prefix_sums[i] != acc ) passed = 0;
+      }
+    }
   }
+
+  int all_passed;
+  MPI_Allreduce(&passed, &all_passed, 1, MPI_INT, MPI_MIN, policy.comm);
+  return all_passed != 0;
 }
 
 /*==============================================================
- * compute elapsed time between start and end
+ * p_any_failed (true on all ranks iff err is not MPI_SUCCESS
+ *               on some rank)
  *==============================================================*/
-long elapsed(struct timeval *start, struct timeval *end) {
-  struct timeval elapsed;
-  /* calculate elapsed time */
-  if(start->tv_usec > end->tv_usec) {
-    end->tv_usec += 1000000;
-    end->tv_sec--;
-  }
-  elapsed.tv_usec = end->tv_usec - start->tv_usec;
-  elapsed.tv_sec  = end->tv_sec  - start->tv_sec;
-  return elapsed.tv_sec*1000000 + elapsed.tv_usec;
+bool p_any_failed(int err, MPI_Comm comm) {
+  int failed = err != MPI_SUCCESS, any_failed;
+  MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_MAX, comm);
+  return any_failed != 0;
 }
 
 /*==============================================================
- * print_elapsed (prints timing statistics)
+ * p_pipelined_prefix_sum (scatter from processor 0 overlapped
+ *                         with the prefix sum; returns the total)
  *==============================================================*/
-void print_elapsed(const char* desc, struct timeval* start, struct timeval* end, int niters) {
-  printf("\n %s total elapsed time = %ld (usec)",
-         desc, elapsed(start, end) / niters);
+long p_pipelined_prefix_sum(const scan::mpi& policy, const vector<int>& gmemory,
+                            const vector<int>& counts, const vector<int>& displs,
+                            vector<int>& input, vector<long>& prefix_sums, bool exclusive,
+                            long chunk) {
+  long total = 0;
+  if( exclusive )
+    scan::scatter_exclusive_scan(policy, gmemory.data(), counts.data(), displs.data(),
+                                 input.data(), input.size(), chunk, prefix_sums.begin(),
+                                 std::plus<long>(), 0L, &total);
+  else
+    scan::scatter_inclusive_scan(policy, gmemory.data(), counts.data(), displs.data(),
+                                 input.data(), input.size(), chunk, prefix_sums.begin(),
+                                 std::plus<long>(), 0L, &total);
+  return total;
+}
+
+/*==============================================================
+ * p_persistent_prefix_sums (numiterations scatters and prefix
+ *   sums with persistent requests and no barrier in the loop;
+ *   returns the time per iteration, the total in *total)
+ *==============================================================*/
+template <typename In>
+double p_persistent_prefix_sums(const scan::mpi& policy, const In* sendbuf, const int* counts,
+                                const int* displs, vector<In>& input, vector<long>& prefix_sums,
+                                bool exclusive, int numiterations, long* total) {
+  struct timeval start, end;
+  scan::persistent_scan<In, long, std::plus<long> >
+    plan(policy, sendbuf, counts, displs, input.data(), input.size(), prefix_sums.data(),
+         std::plus<long>(), 0L, exclusive);
+
+  /* one barrier before and one after the whole loop */
+  MPI_Barrier(policy.comm);
+  gettimeofday(&start, NULL);
+  for(int iteration=0;iteration<numiterations;++iteration) {
+    *total = plan.run();
+  }
+  MPI_Barrier(policy.comm);
+  gettimeofday(&end, NULL);
+  return scan::elapsed(&start, &end) / (double)numiterations;
 }
 
 /*==============================================================
@@ -80,23 +193,37 @@ void print_elapsed(const char* desc, struct timeval* start, struct timeval* end,
  *==============================================================*/
 int main(int argc, char **argv) {
 
-  int nprocs, numints, numints_per_proc, numiterations; /* command line args */
+  int nprocs, numiterations;     /* command line args */
+  long numints, numints_per_proc;
   bool write_outputs = false;
+  uint64_t seed = 1;           /* -s: seed of the counter-based input generator */
+  bool gather_results = true;  /* -n keeps the results distributed */
+  bool local_input = false;    /* -g: every process generates its own slice */
+  bool exclusive = false;      /* -e: exclusive prefix sums */
+  long pipeline_chunk = 0;     /* -p: ints per sub-chunk of the pipelined scatter+scan */
+  bool persistent = false;     /* -P: also time the loop with persistent requests */
+  double persistentTime = 0;
+  const char* timers_file = NULL;  /* -T: CSV report of the phase timers */
+  long seglen = 0;             /* -S: also check segmented prefix sums, seglen ints per segment */
+  long total = 0;              /* total of the sequence, known to every process */
+  const char* input_file = NULL;   /* -i: every process reads its slice of this file */
+  const char* output_file = NULL;  /* -w: every process writes its slice to this file */
+  vector<scan::mpi::exchange_t> exchanges; /* offset exchange strategies to time */
+  vector<double> exchange_times;
 
   int my_id, iteration;
 
-  vector<long> gmemory; /* vector to store the input sequence */
+  vector<int> gmemory;   /* vector to store the input sequence (int32, like rand()) */
   vector<long> results;  /* vector to store the results */
   vector<long> mymemory; /* Vector to store processes numbers */
-  vector<long> partial_sums;
-  long* buffer;         /* Buffer for inter-processor communication */
+  vector<int> myinput;   /* this process' input slice */
+  vector<long> myfile;   /* -i: this process' slice of the int64 file */
 
+  long readTime = 0, writeTime = 0;
   struct timeval gen_start, gen_end; /* gettimeofday stuff */
   struct timeval start, end;         /* gettimeofday stuff */
   struct timezone tzp;
 
-  MPI_Status status;              /* Status variable for MPI operations */
-
   /*---------------------------------------------------------
    * Initializing the MPI environment
    * "nprocs" copies of this program will be initiated by MPI.
@@ -117,226 +244,310 @@ int main(int argc, char **argv) {
   if(argc < 3) {
 
     if(my_id == 0)
-      printf("Usage: %s [numints] [numiterations]\n\n", argv[0]);
+      printf("Usage: %s [numints] [numiterations] [-o] [-n] [-g] [-e] [-s seed] [-x linear|exscan|rd|all]"
+             " [-i file] [-w file] [-p chunk] [-P] [-S seglen] [-T file|-]\n\n", argv[0]);
 
     MPI_Finalize();
     exit(1);
   }
 
-  numints       = atoi(argv[1]);
+  numints       = atol(argv[1]);
   numiterations = atoi(argv[2]);
 
-  if(argc < 4) {
-    write_outputs = false;
-  }
-  else {
-    write_outputs = (string(argv[3]) == "-o");
+  for(int i=3;i<argc;++i) {
+    string arg(argv[i]);
+    if( arg == "-o" ) {
+      write_outputs = true;
+    }
+    else if( arg == "-n" ) {
+      gather_results = false;
+    }
+    else if( arg == "-g" ) {
+      local_input = true;
+      gather_results = false;  /* process 0 never holds the whole sequence */
+    }
+    else if( arg == "-i" && i+1 < argc ) {
+      input_file = argv[++i];
+      local_input = true;      /* the file is never read by a single process */
+      gather_results = false;
+    }
+    else if( arg == "-w" && i+1 < argc ) {
+      output_file = argv[++i];
+    }
+    else if( arg == "-e" ) {
+      exclusive = true;
+    }
+    else if( arg == "-p" && i+1 < argc ) {
+      pipeline_chunk = atol(argv[++i]);
+    }
+    else if( arg == "-T" && i+1 < argc ) {
+      timers_file = argv[++i];
+      scan::timers_enable();
+    }
+    else if( arg == "-P" ) {
+      persistent = true;
+    }
+    else if( arg == "-S" && i+1 < argc ) {
+      seglen = atol(argv[++i]);
+    }
+    else if( arg == "-s" && i+1 < argc ) {
+      seed = strtoull(argv[++i], NULL, 10);
+    }
+    else if( arg == "-x" && i+1 < argc ) {
+      scan::mpi::exchange_t exchange;
+      if( string(argv[++i]) == "all" ) {
+        exchanges.push_back(scan::mpi::linear);
+        exchanges.push_back(scan::mpi::exscan);
+        exchanges.push_back(scan::mpi::recursive_doubling);
+      }
+      else if( scan::parse_exchange(argv[i], &exchange) ) {
+        exchanges.push_back(exchange);
+      }
+    }
   }
+  if( exchanges.empty() ) exchanges.push_back(scan::mpi::exscan);
+  /* -P is compared with the blocking loop of the same exchange */
+  if( persistent && std::find(exchanges.begin(), exchanges.end(), scan::mpi::recursive_doubling)
+                    == exchanges.end() )
+    exchanges.push_back(scan::mpi::recursive_doubling);
+  if( local_input ) pipeline_chunk = 0;  /* nothing is scattered */
 
   MPI_Comm_size(MPI_COMM_WORLD, &nprocs); /* Get number of processors */
 
-  numints_per_proc = ceil(numints / (float)nprocs);
-  if( my_id == 0 ) {
-    partial_sums.resize(nprocs+1, 0);
-  }
-
-  if(my_id == 0)
-    printf("\nExecuting %s: nprocs=%d, numints=%d, numints_per_proc=%d, numiterations=%d\n",
-           argv[0], nprocs, numints, numints_per_proc, numiterations);
+  /* File input: the sequence is the file (its first numints longs if numints > 0) */
+  if( input_file ) {
+    long file_ints = 0;
+    if( scan::file_count<long>(MPI_COMM_WORLD, input_file, &file_ints) != MPI_SUCCESS ) {
+      if(my_id == 0)
+        printf("Cannot open %s\n\n", input_file);
 
-  /*---------------------------------------------------------
-   *  Initialization
-   *  - allocate memory for work area structures and work area
-   *---------------------------------------------------------*/
-  if( my_id == 0 ) {
-    gmemory.reserve(numints);
-    results.resize(numints);
-    /* get starting time */
-    gettimeofday(&gen_start, &tzp);
-    srand(my_id + time(NULL));                  /* Seed rand functions */
-    p_generate_random_ints(gmemory, numints);  /* random parallel fill */
-    gettimeofday(&gen_end, &tzp);
-    print_elapsed("Input generated", &gen_start, &gen_end, 1);
+      MPI_Finalize();
+      exit(1);
+    }
+    if( numints <= 0 || numints > file_ints ) numints = file_ints;
   }
 
-  int myint_first = my_id * numints_per_proc;
-  int myint_last = std::min(myint_first+numints_per_proc, numints);
-
-  if( myint_first < myint_last )
-    mymemory.resize(myint_last - myint_first);
-  else
-    mymemory.resize(1); // hold a dummy value
-  buffer = (long *) malloc(sizeof(long));
+  /* MPI_Scatterv/MPI_Gatherv take int counts and displacements */
+  if( !local_input && numints > INT_MAX ) {
+    if(my_id == 0)
+      printf("numints=%ld needs -g (rank-local input generation)\n\n", numints);
 
-  if(buffer == NULL) {
-    printf("Processor %d - unable to malloc()\n", my_id);
     MPI_Finalize();
     exit(1);
   }
 
-  long totalTime = 0;
+  /* Balanced partition: slice sizes differ by at most one element */
+  long myint_first, myint_last;
+  scan::block_range(numints, nprocs, my_id, &myint_first, &myint_last);
+  long mynumints = myint_last - myint_first;
+  numints_per_proc = numints / nprocs + (numints % nprocs ? 1 : 0);
 
-  MPI_Barrier(MPI_COMM_WORLD); /* Global barrier */
+  vector<int> counts, displs;  /* empty: nothing is scattered or gathered */
+  if( !local_input ) scan::slice_layout(numints, nprocs, counts, displs);
 
-  /* repeat for numiterations times */
-  for (iteration = 0; iteration < numiterations; iteration++) {
-    /* Pass the input sequence to all processors */
-    if( my_id == 0 ) {
-      // send out the integers
-      for(int i=1;i<nprocs;++i) {
-        int pos0 = i * numints_per_proc;
-        int pos1 = std::min(pos0+numints_per_proc, numints);
-        if( pos0 < pos1 )
-          MPI_Send(&gmemory[pos0], pos1-pos0, MPI_LONG, i, 0, MPI_COMM_WORLD);
-      }
-      std::copy(gmemory.begin(), gmemory.begin()+numints_per_proc, mymemory.begin());
-    }
-    else {
-      int pos0 = my_id * numints_per_proc;
-      int pos1 = std::min(pos0+numints_per_proc, numints);
-      if( pos0 < pos1 )
-        MPI_Recv(&mymemory[0], pos1-pos0, MPI_LONG, 0, 0, MPI_COMM_WORLD, &status);
-    }
+  if(my_id == 0)
+    printf("\nExecuting %s: nprocs=%d, numints=%ld, numints_per_proc=%ld, numiterations=%d, seed=%llu%s\n",
+           argv[0], nprocs, numints, numints_per_proc, numiterations, (unsigned long long)seed,
+           input_file ? ", input=file" : local_input ? ", input=local" :
+           pipeline_chunk > 0 ? ", pipelined" : "");
 
-    /* Make sure everybody gets the data */
+  /*---------------------------------------------------------
+   *  Initialization
+   *  - allocate memory for work area structures and work area
+   *---------------------------------------------------------*/
+  if( input_file ) {
+    /* every process reads its own slice, nothing is sent */
+    myfile.resize(mynumints);
     MPI_Barrier(MPI_COMM_WORLD);
-
     gettimeofday(&start, &tzp);
+    int err;
+    {
+      scan::phase_timer timer(scan::phase_read);
+      err = scan::read_slice(MPI_COMM_WORLD, input_file, myint_first, mynumints, myfile.data());
+    }
+    gettimeofday(&end, &tzp);
+    readTime = scan::elapsed(&start, &end);
+    if( p_any_failed(err, MPI_COMM_WORLD) ) {
+      if(my_id == 0)
+        printf("Cannot read %s\n\n", input_file);
+
+      MPI_Finalize();
+      exit(1);
+    }
+  }
+  else if( local_input ) {
+    /* every process generates its own slice, nothing is sent */
+    gettimeofday(&gen_start, &tzp);
+    p_generate_random_ints(myinput, seed, myint_first, mynumints);
+    gettimeofday(&gen_end, &tzp);
+    if( my_id == 0 )
+      scan::print_elapsed("Input generated", &gen_start, &gen_end, 1);
+  }
+  else if( my_id == 0 ) {
+    if( gather_results ) results.resize(numints);
+    /* get starting time */
+    gettimeofday(&gen_start, &tzp);
+    p_generate_random_ints(gmemory, seed, 0, numints);  /* counter-based fill */
+    gettimeofday(&gen_end, &tzp);
+    scan::print_elapsed("Input generated", &gen_start, &gen_end, 1);
+  }
 
-    p_prefix_sum(mymemory); /* Compute the local prefix sum */
+  if( !local_input ) myinput.resize(mynumints);
+  mymemory.resize(mynumints);
 
-    /*---------------------------------------------------------------------
-     * Procesor-wise sums are sent by all the other processors to the master procesor
-     * Master Procesor receives the local sums form all the other processors.
-     *-------------------------------------------------------------------*/
+  long scatterTime = 0;
+  long gatherTime = 0;
 
-    if (my_id == 0) {
-      /*this is the master processor*/
-      /*get the partial sum value from every body*/
-      for(int i = 1; i < nprocs; ++i) {
+  MPI_Barrier(MPI_COMM_WORLD); /* Global barrier */
 
-        /* Receive the message from the ANY processor */
-        /* The message is stored into "buffer" variable */
-        MPI_Recv(buffer, 1, MPI_LONG, i, 0, MPI_COMM_WORLD, &status);
+  /* time every requested offset exchange strategy */
+  for(size_t x = 0; x < exchanges.size(); x++) {
+    scan::mpi policy(MPI_COMM_WORLD, exchanges[x]);
 
-        /* Add the processor-wise sum to the total sum */
-        partial_sums[i+1] = *buffer;
-      }
+    if( input_file ) {
+      exchange_times.push_back(scan::time_scans(policy, MPI_COMM_WORLD, vector<long>(), counts,
+                                                displs, myfile, mymemory, exclusive,
+                                                numiterations, &scatterTime, &total));
+      continue;
     }
-    else {
-      /* this is not the master processor */
-      /* Send the local sum to the master process, which has ID = 0 */
-      long local_prefix = mymemory.back();
-      MPI_Send(&local_prefix, 1, MPI_LONG, 0, 0, MPI_COMM_WORLD);
+    if( pipeline_chunk == 0 ) {
+      exchange_times.push_back(scan::time_scans(policy, MPI_COMM_WORLD, gmemory, counts, displs,
+                                                myinput, mymemory, exclusive, numiterations,
+                                                &scatterTime, &total));
+      continue;
     }
 
-    /* Make sure all partial sums are sent to master */
-    MPI_Barrier(MPI_COMM_WORLD);
+    /* repeat for numiterations times */
+    long totalTime = 0;
+    for (iteration = 0; iteration < numiterations; iteration++) {
+      /* Scatter and prefix sum overlapped, timed together */
+      gettimeofday(&start, &tzp);
+      total = p_pipelined_prefix_sum(policy, gmemory, counts, displs, myinput, mymemory,
+                                     exclusive, pipeline_chunk);
 
-    /* Computer prefix sum of the partial sums */
-    if( my_id == 0 ) {
-      partial_sums[1] = mymemory.back();
-      for(int i=1;i<nprocs+1;++i) {
-        partial_sums[i] += partial_sums[i-1];
-      }
-    }
+      /* Make sure every node finishes the computation */
+      MPI_Barrier(MPI_COMM_WORLD);
 
-    /* Master send back the prefix sum of partial sums */
-    if( my_id == 0 ) {
-      for(int i=1;i<nprocs;++i) {
-        MPI_Send(&partial_sums[i], 1, MPI_LONG, i, 0, MPI_COMM_WORLD);
-      }
-    }
-    else {
-      MPI_Recv(buffer, 1, MPI_LONG, 0, 0, MPI_COMM_WORLD, &status);
-    }
+      if(my_id == 0) {
+        gettimeofday(&end,&tzp);
 
-    /* Every node except master add back partial prefix sum */
-    if( my_id > 0 ) {
-      for(int i=0;i<mymemory.size();++i) {
-        mymemory[i] += *buffer;
+        totalTime += scan::elapsed(&start, &end);
       }
     }
 
-    /* Make sure every node finishes the computation */
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    if(my_id == 0) {
-      gettimeofday(&end,&tzp);
+    exchange_times.push_back(totalTime / (double)numiterations);
+  }
 
-      totalTime += elapsed(&start, &end);
-    }
+  if( persistent ) {
+    /* the same iterations, without barriers and re-posted messages */
+    scan::mpi policy(MPI_COMM_WORLD);
+    if( input_file )
+      persistentTime = p_persistent_prefix_sums(policy, (const long*)NULL, (const int*)NULL, NULL,
+                                                myfile, mymemory, exclusive, numiterations, &total);
+    else if( local_input )
+      persistentTime = p_persistent_prefix_sums(policy, (const int*)NULL, (const int*)NULL, NULL,
+                                                myinput, mymemory, exclusive, numiterations, &total);
+    else
+      persistentTime = p_persistent_prefix_sums(policy, gmemory.data(), counts.data(),
+                                                displs.data(), myinput, mymemory, exclusive,
+                                                numiterations, &total);
   }
 
-  /* Pass the results back to master */
-  if( my_id == 0 ) {
-    // send out the integers
-    for(int i=1;i<nprocs;++i) {
-      int pos0 = i * numints_per_proc;
-      int pos1 = std::min(pos0+numints_per_proc, numints);
-      if( pos0 < pos1 )
-        MPI_Recv(&results[pos0], pos1-pos0, MPI_LONG, i, 0, MPI_COMM_WORLD, &status);
+  if( output_file ) {
+    /* every process writes its own slice, nothing is sent */
+    gettimeofday(&start, &tzp);
+    int err;
+    {
+      scan::phase_timer timer(scan::phase_write);
+      err = scan::write_slice(MPI_COMM_WORLD, output_file, myint_first, mynumints,
+                              mymemory.data());
+    }
+    gettimeofday(&end, &tzp);
+    writeTime = scan::elapsed(&start, &end);
+    if( p_any_failed(err, MPI_COMM_WORLD) ) {
+      if(my_id == 0)
+        printf("Cannot write %s\n\n", output_file);
+
+      MPI_Finalize();
+      exit(1);
     }
-
-    std::copy(mymemory.begin(), mymemory.end(), results.begin());
-  }
-  else {
-    int pos0 = my_id * numints_per_proc;
-    int pos1 = std::min(pos0+numints_per_proc, numints);
-    if( pos0 < pos1 )
-      MPI_Send(&mymemory[0], pos1-pos0, MPI_LONG, 0, 0, MPI_COMM_WORLD);
   }
-  /* Make sure master gets all partial results */
-  MPI_Barrier(MPI_COMM_WORLD);
 
+  bool passed = false;
+  if( gather_results )
+    /* Pass the results back to master */
+    gatherTime = scan::gather_slices(MPI_COMM_WORLD, mymemory, results, counts, displs);
+  else if( input_file )
+    /* Results stay distributed: every process checks its own slice */
+    passed = scan::verify_distributed(myfile, mymemory, exclusive, total, MPI_COMM_WORLD);
+  else
+    passed = scan::verify_distributed(myinput, mymemory, exclusive, total, MPI_COMM_WORLD);
 
   if( my_id == 0 ) {
     std::cout << std::endl;
-    std::cout << "Total elapsed time = " << totalTime / (double)numiterations << " (usec)" << std::endl;
+    for(size_t x=0;x<exchanges.size();++x) {
+      if( pipeline_chunk > 0 )  /* scatter included */
+        std::cout << "Pipelined scatter+scan elapsed time (exchange="
+                  << scan::exchange_name(exchanges[x]) << ", chunk=" << pipeline_chunk << ") = "
+                  << exchange_times[x] << " (usec)" << std::endl;
+      else
+        std::cout << "Total elapsed time (exchange=" << scan::exchange_name(exchanges[x]) << ") = "
+                  << exchange_times[x] << " (usec)" << std::endl;
+    }
+    if( !local_input && pipeline_chunk == 0 )
+      std::cout << "Scatter elapsed time = "
+                << scatterTime / (double)(numiterations * exchanges.size()) << " (usec)" << std::endl;
+    if( persistent ) {
+      /* against the blocking recursive doubling, scatter included */
+      int rd = std::find(exchanges.begin(), exchanges.end(), scan::mpi::recursive_doubling)
+               - exchanges.begin();
+      double barrierTime = exchange_times[rd];
+      if( !local_input && pipeline_chunk == 0 )
+        barrierTime += scatterTime / (double)(numiterations * exchanges.size());
+      std::cout << "Per-iteration latency with barriers (exchange=rd) = " << barrierTime
+                << " (usec)" << std::endl;
+      std::cout << "Per-iteration latency with persistent requests = " << persistentTime
+                << " (usec), " << barrierTime - persistentTime << " (usec) less" << std::endl;
+    }
+    if( gather_results )
+      std::cout << "Gather elapsed time = " << gatherTime << " (usec)" << std::endl;
+    if( input_file )
+      std::cout << "Read elapsed time = " << readTime << " (usec)" << std::endl;
+    if( output_file )
+      std::cout << "Write elapsed time = " << writeTime << " (usec)" << std::endl;
+    std::cout << "Total = " << total << std::endl;
     std::cout << std::endl;
 
-    if( write_outputs ) {
-      /* Write results */
-      std::cout << "Input sequence: " << std::endl;
-      std::ostream_iterator<long> out_it(std::cout, " ");
-      std::copy(gmemory.begin(), gmemory.end(), out_it);
-      std::cout << std::endl;
-
-      std::cout << "Prefix sums: " << std::endl;
-      std::copy(results.begin(), results.end(), out_it);
-      std::cout << std::endl;
-    }
+    if( !gather_results )
+      std::cout << (passed ? "PASSED." : "FAILED.") << std::endl;
+    else
+      scan::report_gathered(gmemory, results, exclusive, total, write_outputs);
+  }
 
-    /* Verify the result */
-    vector<long> result_gold(gmemory.size());
-    std::partial_sum(gmemory.begin(), gmemory.end(), result_gold.begin());
-    if (std::equal(result_gold.begin(), result_gold.end(), results.begin())) {
-      std::cout << "PASSED." << std::endl;
-    }
-    else {
-      std::cout << "FAILED." << std::endl;
-      if( write_outputs ) {
-        std::cout << "Reference prefix sum: ";
-        std::ostream_iterator<long> out_it(std::cout, " ");
-        std::copy(result_gold.begin(), result_gold.end(), out_it);
-        std::cout << std::endl;
-        for (int i = 0; i < result_gold.size(); ++i) {
-          if (result_gold[i] != results[i]) {
-            std::cout << i << "\t" << results[i] << "\t" << result_gold[i] << std::endl;
-          }
-        }
-      }
+  /* phases of all iterations of every loop timed above */
+  if( timers_file )
+    scan::write_phase_report(MPI_COMM_WORLD, timers_file,
+                             numiterations * (exchanges.size() + (persistent ? 1 : 0)));
+
+  /* segmented prefix sums of the generated input, for every exchange strategy */
+  if( seglen > 0 ) {
+    bool timed = scan::timers_enabled();
+    scan::timers_enable(false);
+    for(size_t x=0;x<exchanges.size();++x) {
+      scan::mpi policy(MPI_COMM_WORLD, exchanges[x]);
+      bool seg_passed = p_verify_segmented(policy, seed, myint_first, mynumints, seglen);
+      if( my_id == 0 )
+        std::cout << "Segmented prefix sums (exchange=" << scan::exchange_name(exchanges[x])
+                  << ", seglen=" << seglen << "): " << (seg_passed ? "PASSED." : "FAILED.")
+                  << std::endl;
     }
+    scan::timers_enable(timed);
   }
 
   /*---------------------------------------------------------
    *  Cleanup
-   *  - free memory
    *---------------------------------------------------------*/
 
-  /* free memory */
-  free(buffer);
-
   MPI_Finalize();
 
   return 0;
@@ -7,12 +7,21 @@
 /*---------------------------------------------------------
  *  Parallel Prefix Sum
  *
- *  1. Each thread generates roughly numints_per_proc random integers (in parallel OpenMP region)
- *  2. Each thread computes the prefix sum of his numints_per_proc random integers (in parallel OpenMP region)
- *  3  One thread computes the prefix sum of the partial results.
- *  4. Each thread add back the partial prefix sum to his numints_per_proc prefix sums.
+ *  0. Threads are pinned to cores and every thread first touches the pages
+ *     of its block of data and prefix_sums (scan/numa.h)
+ *  1. Each thread generates its block of the random integers (in parallel OpenMP region),
+ *     stored as int32 and summed into longs in step 2
+ *  2. The prefix sum is computed by the OpenMP backend of scan/scan.h
+ *     (algorithm selected by -a, scan_then_propagate by default), inclusive or
+ *     with -e exclusive; the total of the sequence comes with it
  *
- *  NOTE: steps 2-4 are repeated as many times as requested (numiterations)
+ *  With -i, step 1 maps a binary file of int32/int64/float/double instead,
+ *  and -w maps the output file the prefix sums are written to
+ *  (scan/file_scan.h); -e applies to the file as well.
+ *
+ *  NOTE: step 2 is repeated as many times as requested (numiterations)
+ *  With -T file, the phases of step 2 are timed per thread and reported
+ *  as CSV (scan/timer.h) to file, or to stdout for -T -.
  *---------------------------------------------------------*/
 
 
@@ -29,6 +38,10 @@
 #include <iterator>
 #include <numeric>
 #include <cmath>
+#include "scan/scan.h"
+#include "scan/random.h"
+#include "scan/numa.h"
+#include "scan/file_scan.h"
 using namespace std;
 
 /*==============================================================
@@ -55,6 +68,18 @@ void print_elapsed(const char* desc, struct timeval* start, struct timeval* end,
 }
 
 
+/*==============================================================
+ * print_node_bytes (reports on which NUMA nodes a buffer is)
+ *==============================================================*/
+void print_node_bytes(const char* desc, const void* addr, size_t bytes) {
+  std::vector<long> nodes = scan::node_bytes(addr, bytes);
+  printf(" %s:", desc);
+  if( nodes.empty() ) printf(" unknown");
+  for(int i=0;i<(int)nodes.size();++i)
+    if( nodes[i] > 0 ) printf(" node%d=%ld", i, nodes[i]);
+  printf(" (bytes)\n");
+}
+
 /*==============================================================
  *  Main Program (Parallel Summation)
  *==============================================================*/
@@ -65,16 +90,23 @@ int main(int argc, char *argv[]) {
   int numprocs = 0;
   int numints_per_proc = 0;
   bool write_output = false;
-
-  vector<long> data;
-  vector<long> partial_sums;
-  vector<long> prefix_sums;
+  bool pin = true;    /* -u leaves the threads unpinned */
+  uint64_t seed = 1;  /* -s: seed of the counter-based input generator */
+  scan::openmp::algorithm_t algorithm = scan::openmp::scan_then_propagate;  /* -a */
+  const char* input_file = NULL;   /* -i: binary input file instead of random ints */
+  const char* output_file = NULL;  /* -w: binary output file */
+  string input_type = "int64";     /* -t: int32, int64, float or double */
+  bool exclusive = false;          /* -e: exclusive prefix sums */
+  bool reproducible = false;       /* -r: reproducible sums of a float/double file */
+  long total = 0;                  /* total of the sequence */
+  const char* timers_file = NULL;  /* -T: CSV report of the phase timers */
 
   struct timeval start, end;   /* gettimeofday stuff */
   struct timezone tzp;
 
   if( argc < 4 ) {
-    printf("Usage: %s [numprocs] [numints] [numiterations]\n\n", argv[0]);
+    printf("Usage: %s [numprocs] [numints] [numiterations] [-o] [-u] [-e] [-s seed] [-a algorithm]"
+           " [-i file [-t int32|int64|float|double] [-w file] [-r]] [-T file|-]\n\n", argv[0]);
     exit(1);
   }
 
@@ -83,25 +115,108 @@ int main(int argc, char *argv[]) {
   numiterations = atoi(argv[3]);
   numints_per_proc = ceil(numints / (float)numprocs);
 
-  if( argc < 5 ) {
-    write_output = false;
+  for(int i=4;i<argc;++i) {
+    string arg(argv[i]);
+    if( arg == "-o" ) {
+      write_output = true;
+    }
+    else if( arg == "-u" ) {
+      pin = false;
+    }
+    else if( arg == "-e" ) {
+      exclusive = true;
+    }
+    else if( arg == "-r" ) {
+      reproducible = true;
+    }
+    else if( arg == "-T" && i+1 < argc ) {
+      timers_file = argv[++i];
+      scan::timers_enable();
+    }
+    else if( arg == "-s" && i+1 < argc ) {
+      seed = strtoull(argv[++i], NULL, 10);
+    }
+    else if( arg == "-i" && i+1 < argc ) {
+      input_file = argv[++i];
+    }
+    else if( arg == "-t" && i+1 < argc ) {
+      input_type = argv[++i];
+    }
+    else if( arg == "-w" && i+1 < argc ) {
+      output_file = argv[++i];
+    }
+    else if( arg == "-a" && i+1 < argc ) {
+      if( !scan::parse_algorithm(argv[++i], &algorithm) ) {
+        printf("Unknown algorithm %s\n\n", argv[i]);
+        exit(1);
+      }
+    }
   }
-  else {
-    write_output = (string(argv[4]) == "-o");
+
+  /* the prefix sums of generated ints are never written */
+  if( output_file && !input_file ) {
+    printf("-w needs -i file\n\n");
+    exit(1);
   }
 
-  printf("\nExecuting %s: nthreads=%d, numints=%d, numints_per_proc=%d, numiterations=%d\n",
-         argv[0], numprocs, numints, numints_per_proc, numiterations);
+  /* integer sums are exact already; only float and double sums depend on the threads */
+  if( reproducible && (!input_file || (input_type != "float" && input_type != "double")) ) {
+    printf("-r needs -i file -t float|double\n\n");
+    exit(1);
+  }
 
-  /* Allocate shared memory, enough for each thread to have numints*/
-  data.resize(numints);
+  /* the reproducible scan is inclusive only */
+  if( reproducible && exclusive ) {
+    printf("-r and -e cannot be combined\n\n");
+    exit(1);
+  }
 
-  /* Allocate shared memory for partial_sums */
-  partial_sums.resize(numprocs+1, 0);
+  printf("\nExecuting %s: nthreads=%d, numints=%d, numints_per_proc=%d, numiterations=%d, seed=%llu, algorithm=%s\n",
+         argv[0], numprocs, numints, numints_per_proc, numiterations, (unsigned long long)seed,
+         scan::algorithm_name(algorithm));
 
   /* Set number of threads */
   omp_set_num_threads(numprocs);
 
+  /* Pin the team first, so that the pages land next to the threads using them */
+  if( pin )
+    printf("Pinned %d of %d threads\n", scan::pin_threads(numprocs), numprocs);
+
+  /* File mode: scan the mapped file (its first numints elements if numints > 0) */
+  if( input_file ) {
+    scan::openmp policy(numprocs, algorithm);
+    scan::file_scan_options options;
+    options.exclusive = exclusive;
+    options.reproducible = reproducible;
+    options.write_output = write_output;
+    int status = -1;
+    if( input_type == "int32" )
+      status = scan::scan_file<int32_t>(policy, input_file, output_file, numints, numiterations,
+                                        options);
+    else if( input_type == "int64" )
+      status = scan::scan_file<int64_t>(policy, input_file, output_file, numints, numiterations,
+                                        options);
+    else if( input_type == "float" )
+      status = scan::scan_file<float>(policy, input_file, output_file, numints, numiterations,
+                                      options);
+    else if( input_type == "double" )
+      status = scan::scan_file<double>(policy, input_file, output_file, numints, numiterations,
+                                       options);
+    if( status >= 0 ) {
+      if( timers_file ) scan::write_phase_report(timers_file, numiterations);
+      return status;
+    }
+    printf("Unknown type %s\n\n", input_type.c_str());
+    return 1;
+  }
+
+  /* Allocate shared memory, every thread first-touches its own block */
+  /* the input is int32 (like rand()) and summed into longs: 12 bytes per element, not 16 */
+  scan::numa_buffer<int> data(numints, numprocs);
+  scan::numa_buffer<long> prefix_sums(numints, numprocs);
+  print_node_bytes("data", data.data(), numints * sizeof(int));
+  print_node_bytes("prefix_sums", prefix_sums.data(), numints * sizeof(long));
+
   /*****************************************************
    * Generate the random ints in parallel              *
    *****************************************************/
@@ -112,25 +227,14 @@ int main(int argc, char *argv[]) {
     /* get the current thread ID in the parallel region */
     tid = omp_get_thread_num();
 
-    srand(tid + time(NULL));    /* Seed rand functions */
-
-    int pos0 = tid*numints_per_proc;
-    int pos1 = std::min(pos0+numints_per_proc, numints);
-
-    if( pos0 < pos1 ) {
+    int pos0, pos1;
+    scan::block_range(numints, omp_get_num_threads(), tid, &pos0, &pos1);
 
-      vector<long>::iterator it_cur = data.begin() + pos0;
-      vector<long>::iterator it_end = data.begin() + pos1;
-
-      for(; it_cur != it_end ; ++it_cur) {
-        *it_cur = rand();
-      }
-
-    }
+    /* element i only depends on (seed, i), whatever the number of threads */
+    if( pos0 < pos1 )
+      scan::random_ints(seed, pos0, &data[pos0], pos1 - pos0);
   }
 
-  /* Make a copy of data as input for prefix sums */
-
   /*****************************************************
    * Generate the sum of the ints in parallel          *
    * NOTE: Repeated for numiterations                  *
@@ -138,45 +242,15 @@ int main(int argc, char *argv[]) {
 
   long totalTime = 0;
   for(int iteration=0; iteration < numiterations; ++iteration) {
-    prefix_sums = data;
-
     gettimeofday(&start, &tzp);
-#pragma omp parallel shared(numints_per_proc,prefix_sums,partial_sums)
-    {
-      int tid;
 
-      /* get the current thread ID in the parallel region */
-      tid = omp_get_thread_num();
-
-      /* Compute the local prefix sums */
-      int pos0 = tid*numints_per_proc;
-      int pos1 = std::min(pos0+numints_per_proc, numints);
-
-      for(int pos = pos0+1;pos<pos1;++pos)
-        prefix_sums[pos] += prefix_sums[pos-1];
-      partial_sums[tid+1] = prefix_sums[pos1-1];
-    }
-
-    /* Compute the prefix sum of the partial sums */
-    for(int i=1;i<partial_sums.size();++i) partial_sums[i] += partial_sums[i-1];
-
-#pragma omp parallel shared(numints_per_proc,prefix_sums,partial_sums)
-    {
-      int tid;
-
-      /* get the current thread ID in the parallel region */
-      tid = omp_get_thread_num();
-
-      /* get the prefix sum of the partial sums */
-      long ps = partial_sums[tid];
-
-      /* Compute the local prefix sums */
-      int pos0 = tid*numints_per_proc;
-      int pos1 = std::min(pos0+numints_per_proc, numints);
-
-      /* add it back to the prefix sums */
-      for(int pos=pos0;pos<pos1;++pos) prefix_sums[pos] += ps;
-    }
+    /* out of place: data is read once and prefix_sums written once, no copy */
+    if( exclusive )
+      scan::exclusive_scan(scan::openmp(numprocs, algorithm), data.begin(), data.end(),
+                           prefix_sums.begin(), std::plus<long>(), 0L, &total);
+    else
+      scan::inclusive_scan(scan::openmp(numprocs, algorithm), data.begin(), data.end(),
+                           prefix_sums.begin(), std::plus<long>(), 0L, &total);
 
     gettimeofday(&end,&tzp);
     totalTime += elapsed(&start, &end);
@@ -188,7 +262,9 @@ int main(int argc, char *argv[]) {
    *****************************************************/
 
   std::cout << "Total elapsed time = " << totalTime / (double)numiterations << " (usec)" << std::endl;
+  std::cout << "Total = " << total << std::endl;
   std::cout << std::endl;
+  if( timers_file ) scan::write_phase_report(timers_file, numiterations);
 
   if( write_output ) {
     std::ostream_iterator<long> out_it (std::cout," ");
@@ -203,9 +279,15 @@ int main(int argc, char *argv[]) {
   }
 
   /* Verify the result */
-  vector<long> result_gold(data.size());
-  std::partial_sum(data.begin(), data.end(), result_gold.begin());
-  if( std::equal(result_gold.begin(), result_gold.end(), prefix_sums.begin()) ) {
+  vector<long> result_gold(data.begin(), data.end());  /* sum in long */
+  std::partial_sum(result_gold.begin(), result_gold.end(), result_gold.begin());
+  long gold_total = result_gold.empty() ? 0 : result_gold.back();
+  if( exclusive ) {
+    result_gold.insert(result_gold.begin(), 0L);
+    result_gold.pop_back();
+  }
+  if( total == gold_total &&
+      std::equal(result_gold.begin(), result_gold.end(), prefix_sums.begin()) ) {
     std::cout << "PASSED." << std::endl;
   }
   else {
@@ -215,7 +297,7 @@ int main(int argc, char *argv[]) {
       std::cout << "Reference prefix sum: ";
       std::copy(result_gold.begin(), result_gold.end(), out_it);
       std::cout << std::endl;
-      for(int i=0;i<result_gold.size();++i) {
+      for(size_t i=0;i<result_gold.size();++i) {
         if( result_gold[i] != prefix_sums[i] ) {
           std::cout << i << "\t" << prefix_sums[i] << "\t" << result_gold[i] << std::endl;
         }
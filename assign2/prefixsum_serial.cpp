@@ -20,6 +20,9 @@
 #include <iterator>
 #include <numeric>
 #include <cmath>
+#include "scan/scan.h"
+#include "scan/random.h"
+#include "scan/file_scan.h"
 using namespace std;
 
 /*==============================================================
@@ -53,6 +56,11 @@ int main(int argc, char *argv[]) {
 
     int numints = 0;
     int numiterations = 0;
+    uint64_t seed = 1;  /* -s: seed of the counter-based input generator */
+    bool write_output = false;       /* -o: print a file scan (random runs always print) */
+    const char* input_file = NULL;   /* -i: binary input file instead of random ints */
+    const char* output_file = NULL;  /* -w: binary output file */
+    string input_type = "int64";     /* -t: int32, int64, float or double */
 
     vector<long> data;
     vector<long> prefix_sums;
@@ -61,26 +69,60 @@ int main(int argc, char *argv[]) {
     struct timezone tzp;
 
     if( argc < 3) {
-        printf("Usage: %s [numints] [numiterations]\n\n", argv[0]);
+        printf("Usage: %s [numints] [numiterations] [-s seed]"
+               " [-i file [-t int32|int64|float|double] [-w file] [-o]]\n\n", argv[0]);
         exit(1);
     }
 
     numints       = atoi(argv[1]);
     numiterations = atoi(argv[2]);
 
-    printf("\nExecuting %s: numints=%d, numiterations=%d\n",
-            argv[0], numints, numiterations);
+    for(int i=3;i<argc;++i) {
+        string arg(argv[i]);
+        if( arg == "-s" && i+1 < argc ) seed = strtoull(argv[++i], NULL, 10);
+        else if( arg == "-i" && i+1 < argc ) input_file = argv[++i];
+        else if( arg == "-t" && i+1 < argc ) input_type = argv[++i];
+        else if( arg == "-w" && i+1 < argc ) output_file = argv[++i];
+        else if( arg == "-o" ) write_output = true;
+    }
+
+    /* the prefix sums of generated ints are never written */
+    if( output_file && !input_file ) {
+        printf("-w needs -i file\n\n");
+        return 1;
+    }
 
-    /* Allocate memory for the input sequence */
+    printf("\nExecuting %s: numints=%d, numiterations=%d, seed=%llu\n",
+            argv[0], numints, numiterations, (unsigned long long)seed);
+
+    /* File mode: scan the mapped file (its first numints elements if numints > 0) */
+    if( input_file ) {
+        scan::file_scan_options options;
+        options.write_output = write_output;
+        if( input_type == "int32" )
+            return scan::scan_file<int32_t>(scan::serial(), input_file, output_file, numints,
+                                            numiterations, options);
+        if( input_type == "int64" )
+            return scan::scan_file<int64_t>(scan::serial(), input_file, output_file, numints,
+                                            numiterations, options);
+        if( input_type == "float" )
+            return scan::scan_file<float>(scan::serial(), input_file, output_file, numints,
+                                          numiterations, options);
+        if( input_type == "double" )
+            return scan::scan_file<double>(scan::serial(), input_file, output_file, numints,
+                                           numiterations, options);
+        printf("Unknown type %s\n\n", input_type.c_str());
+        return 1;
+    }
+
+    /* Allocate memory for the input sequence and the prefix sums */
     data.resize(numints);
+    prefix_sums.resize(numints);
 
     /*****************************************************
      * Generate the random ints                          *
      *****************************************************/
-    srand(tid + time(NULL));    /* Seed rand functions */
-    std::for_each(data.begin(), data.end(), [](long &x){ x = rand(); });
-
-    /* Make a copy of data as input for prefix sums */
+    scan::random_ints(seed, 0, data.data(), data.size());
 
     /*****************************************************
      * Generate the sum of the ints                      *
@@ -89,12 +131,11 @@ int main(int argc, char *argv[]) {
 
     long totalTime = 0;
     for(int iteration=0; iteration < numiterations; ++iteration) {
-        prefix_sums = data;
-
         gettimeofday(&start, &tzp);
 
-        /* Compute the prefix sum */
-        for(int i=1;i<numints;++i) prefix_sums[i] += prefix_sums[i-1];
+        /* Compute the prefix sum, out of place (data is read once, no copy) */
+        scan::inclusive_scan(data.begin(), data.end(), prefix_sums.begin(),
+                             std::plus<long>(), 0L);
 
         gettimeofday(&end,&tzp);
         totalTime += elapsed(&start, &end);
@@ -128,7 +169,7 @@ int main(int argc, char *argv[]) {
         std::copy(result_gold.begin(), result_gold.end(), out_it);
         std::cout << std::endl;
         std::cout << "FAILED." << std::endl;
-        for(int i=0;i<result_gold.size();++i) {
+        for(size_t i=0;i<result_gold.size();++i) {
             if( result_gold[i] != prefix_sums[i] ) {
                 std::cout << i << "\t" << prefix_sums[i] << "\t" << result_gold[i] << std::endl;
             }
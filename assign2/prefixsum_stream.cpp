@@ -0,0 +1,193 @@
+/*
+ *  prefixsum_stream.cpp - Out-of-core prefix sum of a binary file or pipe.
+ *  This program uses OpenMP.
+ */
+
+/*---------------------------------------------------------
+ *  Streaming Prefix Sum
+ *
+ *  1. A reader thread reads blocks of blockints elements from the input
+ *  2. The OpenMP backend of scan/scan.h scans every block in place, seeded
+ *     with the total of the preceding blocks
+ *  3. A writer thread writes the scanned blocks to the output
+ *
+ *  The three stages overlap over a ring of buffers (scan/stream.h), so the
+ *  sequence may be much larger than the memory.  When both the input and
+ *  the output are files, the output is verified by reading both back.
+ *---------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <omp.h>
+#include <vector>
+#include <string>
+#include "scan/scan.h"
+#include "scan/stream.h"
+#include "scan/file_scan.h"
+using namespace std;
+
+/*==============================================================
+ * compute elapsed time between start and end
+ *==============================================================*/
+long elapsed(struct timeval *start, struct timeval *end) {
+  struct timeval elapsed;
+  /* calculate elapsed time */
+  if(start->tv_usec > end->tv_usec) {
+    end->tv_usec += 1000000;
+    end->tv_sec--;
+  }
+  elapsed.tv_usec = end->tv_usec - start->tv_usec;
+  elapsed.tv_sec  = end->tv_sec  - start->tv_sec;
+  return elapsed.tv_sec*1000000 + elapsed.tv_usec;
+}
+
+/*==============================================================
+ * verify_files (reads the input and the output files back block
+ *               by block; returns the index of the first wrong
+ *               prefix sum, -1 if none, -2 on a short output)
+ *==============================================================*/
+template <typename T>
+long verify_files(const char* input, const char* output, long block_size) {
+  int in_fd = open(input, O_RDONLY);
+  int out_fd = open(output, O_RDONLY);
+  if( in_fd < 0 || out_fd < 0 ) {
+    perror("verify");
+    return -2;
+  }
+
+  vector<T> x(block_size), y(block_size);
+  scan::reference_sum<T> reference;
+  long mismatch = -1;
+  for(long base=0; mismatch == -1; base+=block_size) {
+    long n = scan::detail::read_full(in_fd, x.data(), block_size * sizeof(T)) / (long)sizeof(T);
+    if( n <= 0 ) break;
+    if( scan::detail::read_full(out_fd, y.data(), n * sizeof(T)) != (long)(n * sizeof(T)) ) {
+      mismatch = -2;
+      break;
+    }
+    for(long i=0;i<n;++i) {
+      if( !reference.check(x[i], y[i]) ) {
+        mismatch = base + i;
+        break;
+      }
+    }
+  }
+
+  close(in_fd);
+  close(out_fd);
+  return mismatch;
+}
+
+/*==============================================================
+ * run_stream (streams input into output as elements of T;
+ *             NULL stands for stdin / stdout)
+ *==============================================================*/
+template <typename T>
+int run_stream(const char* input, const char* output, const scan::openmp& policy,
+               long block_size, int nbuffers) {
+  struct timeval start, end;   /* gettimeofday stuff */
+  struct timezone tzp;
+
+  /* reports go to stderr when the prefix sums go to stdout */
+  FILE* report = output ? stdout : stderr;
+
+  int in_fd = input ? open(input, O_RDONLY) : STDIN_FILENO;
+  if( in_fd < 0 ) {
+    perror(input);
+    return 1;
+  }
+  int out_fd = output ? open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644) : STDOUT_FILENO;
+  if( out_fd < 0 ) {
+    perror(output);
+    return 1;
+  }
+
+  scan::stream_stats stats;
+  gettimeofday(&start, &tzp);
+  bool ok = scan::stream_scan<T>(policy, in_fd, out_fd, block_size, nbuffers, &stats);
+  gettimeofday(&end, &tzp);
+  if( !ok ) perror("stream");
+
+  if( input ) close(in_fd);
+  if( output ) close(out_fd);
+
+  long usec = elapsed(&start, &end);
+  double mbytes = 2.0 * stats.elements * sizeof(T) / 1e6;
+  fprintf(report, "Total elapsed time = %ld (usec), %ld elements in %ld blocks, %.1f MB/s\n",
+          usec, stats.elements, stats.blocks, usec > 0 ? mbytes / (usec / 1e6) : 0.0);
+  fprintf(report, "Busy time: read = %.0f, scan = %.0f, write = %.0f (usec); scan waited %.0f (usec)\n\n",
+          stats.read_usec, stats.scan_usec, stats.write_usec, stats.scan_wait);
+  if( !ok ) return 1;
+
+  /* Verify the result when both ends are files */
+  if( input && output ) {
+    long mismatch = verify_files<T>(input, output, block_size);
+    if( mismatch == -1 ) {
+      fprintf(report, "PASSED.\n");
+    }
+    else {
+      fprintf(report, "FAILED.\n");
+      if( mismatch >= 0 ) fprintf(report, "first mismatch at %ld\n", mismatch);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*==============================================================
+ *  Main Program
+ *==============================================================*/
+int main(int argc, char *argv[]) {
+
+  if( argc < 3 ) {
+    printf("Usage: %s [numthreads] [blockints] [-i file] [-w file] [-t int32|int64|float|double]"
+           " [-b nbuffers] [-a algorithm]\n\n", argv[0]);
+    exit(1);
+  }
+
+  int numthreads  = atoi(argv[1]);
+  long blockints  = atol(argv[2]);
+  const char* input_file = NULL;   /* -i: input file, stdin by default */
+  const char* output_file = NULL;  /* -w: output file, stdout by default */
+  string input_type = "int64";     /* -t: element type */
+  int nbuffers = 3;                /* -b: buffers in flight */
+  scan::openmp::algorithm_t algorithm = scan::openmp::scan_then_propagate;  /* -a */
+
+  for(int i=3;i<argc;++i) {
+    string arg(argv[i]);
+    if( arg == "-i" && i+1 < argc ) input_file = argv[++i];
+    else if( arg == "-w" && i+1 < argc ) output_file = argv[++i];
+    else if( arg == "-t" && i+1 < argc ) input_type = argv[++i];
+    else if( arg == "-b" && i+1 < argc ) nbuffers = atoi(argv[++i]);
+    else if( arg == "-a" && i+1 < argc ) {
+      if( !scan::parse_algorithm(argv[++i], &algorithm) ) {
+        fprintf(stderr, "Unknown algorithm %s\n\n", argv[i]);
+        exit(1);
+      }
+    }
+  }
+  if( blockints <= 0 ) blockints = 1 << 20;
+  if( input_file && string(input_file) == "-" ) input_file = NULL;
+  if( output_file && string(output_file) == "-" ) output_file = NULL;
+
+  fprintf(output_file ? stdout : stderr,
+          "\nExecuting %s: nthreads=%d, blockints=%ld, nbuffers=%d, type=%s, algorithm=%s\n",
+          argv[0], numthreads, blockints, nbuffers, input_type.c_str(),
+          scan::algorithm_name(algorithm));
+
+  scan::openmp policy(numthreads, algorithm);
+  if( input_type == "int32" )
+    return run_stream<int32_t>(input_file, output_file, policy, blockints, nbuffers);
+  if( input_type == "int64" )
+    return run_stream<int64_t>(input_file, output_file, policy, blockints, nbuffers);
+  if( input_type == "float" )
+    return run_stream<float>(input_file, output_file, policy, blockints, nbuffers);
+  if( input_type == "double" )
+    return run_stream<double>(input_file, output_file, policy, blockints, nbuffers);
+
+  fprintf(stderr, "Unknown type %s\n\n", input_type.c_str());
+  return 1;
+}
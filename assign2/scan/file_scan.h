@@ -0,0 +1,220 @@
+/*
+ *  scan/file_scan.h - Prefix scan of a mapped binary file, and its check.
+ */
+
+/*---------------------------------------------------------
+ *  File Scan
+ *
+ *  scan_file maps a binary file of T (scan/mapped_file.h), scans it with
+ *  the backend of the policy numiterations times, inclusive or exclusive,
+ *  into a mapped output file or into memory, and checks the result:
+ *
+ *    return scan::scan_file<double>(scan::openmp(8), "data.bin", "sums.bin",
+ *                                   0, 10, options);
+ *
+ *  The check is a running serial prefix sum (reference_sum), so that files
+ *  too large for memory can be checked block by block as well.  Integers
+ *  must match exactly, wrapping around like the scan; floating point sums
+ *  must lie within the rounding error bound of both summations.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_FILE_SCAN_H
+#define SCAN_FILE_SCAN_H
+
+#include <stdio.h>
+#include <math.h>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "scan.h"
+#include "mapped_file.h"
+#include "timer.h"
+#ifdef _OPENMP
+#include "numa.h"
+#endif
+
+namespace scan {
+
+/*==============================================================
+ * reference_sum (running serial prefix sum; check(x, result)
+ *                adds x and tells if result is its prefix sum)
+ *==============================================================*/
+template <typename T, bool Float = std::is_floating_point<T>::value>
+struct reference_sum {
+  typedef typename std::make_unsigned<T>::type U;
+  U gold;
+
+  reference_sum() : gold(0) {
+  }
+
+  bool check(T x, T result, bool exclusive = false) {
+    U before = gold;
+    gold += (U)x;
+    return (U)result == (exclusive ? before : gold);
+  }
+};
+
+template <typename T>
+struct reference_sum<T, true> {
+  T gold;
+  double abs_sum;
+  long count;
+
+  reference_sum() : gold(0), abs_sum(0), count(0) {
+  }
+
+  bool check(T x, T result, bool exclusive = false) {
+    T before = gold;
+    gold += x;
+    abs_sum += fabs((double)x);
+    double bound = 2.0 * (++count) * std::numeric_limits<T>::epsilon() * abs_sum;
+    return fabs((double)result - (double)(exclusive ? before : gold)) <= bound;
+  }
+};
+
+/*==============================================================
+ * first_mismatch (index of the first wrong prefix sum, -1 if none)
+ *==============================================================*/
+template <typename T>
+long first_mismatch(const T* input, const T* prefix_sums, long n, bool exclusive = false) {
+  reference_sum<T> reference;
+  for(long i=0;i<n;++i)
+    if( !reference.check(input[i], prefix_sums[i], exclusive) ) return i;
+  return -1;
+}
+
+/* Options of scan_file */
+struct file_scan_options {
+  bool exclusive;      /* exclusive prefix sums */
+  bool reproducible;   /* reproducible_inclusive_scan (float and double only) */
+  bool write_output;   /* print both sequences */
+
+  file_scan_options() : exclusive(false), reproducible(false), write_output(false) {
+  }
+};
+
+namespace detail {
+
+/*==============================================================
+ * file_buffer (in-memory output of scan_file; with OpenMP its
+ *              pages are first touched by the threads)
+ *==============================================================*/
+template <typename T, typename Policy>
+class file_buffer {
+ public:
+  file_buffer(long n, const Policy&) : data_(n) {
+  }
+  T* data() { return data_.data(); }
+
+ private:
+  std::vector<T> data_;
+};
+
+#ifdef _OPENMP
+template <typename T>
+class file_buffer<T, openmp> {
+ public:
+  file_buffer(long n, const openmp& policy) : data_(n, policy.num_threads()) {
+  }
+  T* data() { return data_.data(); }
+
+ private:
+  numa_buffer<T> data_;
+};
+#endif
+
+template <typename Policy, typename T>
+void file_scan_once(const Policy& policy, const T* first, const T* last, T* out,
+                    const file_scan_options& options, std::true_type /* floating point */) {
+  if( options.reproducible )
+    reproducible_inclusive_scan(policy, first, last, out);
+  else if( options.exclusive )
+    exclusive_scan(policy, first, last, out, std::plus<T>(), T());
+  else
+    inclusive_scan(policy, first, last, out, std::plus<T>(), T());
+}
+
+template <typename Policy, typename T>
+void file_scan_once(const Policy& policy, const T* first, const T* last, T* out,
+                    const file_scan_options& options, std::false_type) {
+  if( options.exclusive )
+    exclusive_scan(policy, first, last, out, std::plus<T>(), T());
+  else
+    inclusive_scan(policy, first, last, out, std::plus<T>(), T());
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * scan_file (scans the binary file input, an array of T, into
+ *            the binary file output, or into memory if NULL;
+ *            numints > 0 scans only the first numints elements.
+ *            Prints the time per iteration and PASSED or FAILED;
+ *            returns 0 if passed, 1 otherwise)
+ *==============================================================*/
+template <typename T, typename Policy>
+int scan_file(const Policy& policy, const char* input, const char* output, long numints,
+              int numiterations, const file_scan_options& options) {
+  mapped_file in, out;
+  if( !in.open_read(input) ) {
+    perror(input);
+    return 1;
+  }
+  long n = in.count<T>();
+  if( numints > 0 && numints < n ) n = numints;
+  const T* data = in.begin<T>();
+
+  /* the prefix sums go straight to the mapped output file, if any */
+  detail::file_buffer<T, Policy> buffer(output ? 0 : n, policy);
+  T* prefix_sums = buffer.data();
+  if( output ) {
+    if( !out.create(output, n * sizeof(T)) ) {
+      perror(output);
+      return 1;
+    }
+    prefix_sums = out.begin<T>();
+  }
+
+  printf("Input %s: %ld elements of %d bytes, output %s\n",
+         input, n, (int)sizeof(T), output ? output : "in memory");
+
+  double seconds = 0;
+  for(int iteration=0; iteration < numiterations; ++iteration) {
+    double start = detail::timer_now();
+    detail::file_scan_once(policy, data, data + n, prefix_sums, options,
+                           typename std::is_floating_point<T>::type());
+    seconds += detail::timer_now() - start;
+  }
+
+  std::cout << "Total elapsed time = " << seconds * 1e6 / numiterations << " (usec)" << std::endl;
+  std::cout << std::endl;
+
+  if( options.write_output ) {
+    std::ostream_iterator<T> out_it (std::cout," ");
+    std::cout << "Input sequence: ";
+    std::copy(data, data + n, out_it);
+    std::cout << std::endl;
+
+    std::cout << "Prefix sum: ";
+    std::copy(prefix_sums, prefix_sums + n, out_it);
+    std::cout << std::endl;
+  }
+
+  /* Verify the result */
+  long mismatch = first_mismatch(data, prefix_sums, n, options.exclusive);
+  if( mismatch < 0 ) {
+    std::cout << "PASSED." << std::endl;
+    return 0;
+  }
+  std::cout << "FAILED." << std::endl;
+  std::cout << mismatch << "\t" << prefix_sums[mismatch] << std::endl;
+  return 1;
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_FILE_SCAN_H */
@@ -0,0 +1,191 @@
+/*
+ *  scan/hybrid.h - Hybrid MPI+OpenMP backend of the prefix scan library.
+ */
+
+/*---------------------------------------------------------
+ *  Parallel Prefix Scan (MPI processes x OpenMP threads)
+ *
+ *  Meant for one process per node (or socket) with one thread per core.
+ *  Every process passes its own slice, as with the MPI backend.
+ *
+ *  1. The threads of each process scan (scan_then_propagate) or reduce
+ *     (the other algorithms of the openmp policy) one block each of its
+ *     slice
+ *  2. The processes exchange the totals of their slices (one value per
+ *     process, strategy selected by the mpi policy)
+ *  3. Each thread folds the offset of its process and the totals of the
+ *     preceding blocks into one carry, and adds it back to its block
+ *     (scan_then_propagate) or scans the block seeded with it
+ *     (reduce_then_scan); decoupled_lookback and dynamic_chunks scan the
+ *     slice seeded with the offset of the process instead.
+ *
+ *  Every element is written once more at most after its local scan, as
+ *  in the OpenMP backend alone; the offset of the process costs no pass
+ *  of its own.
+ *
+ *  Exclusive scans and the total work as with the MPI backend.
+ *
+ *  MPI is only called outside of parallel regions by the thread that
+ *  called inclusive_scan, so MPI_THREAD_FUNNELED is enough.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_HYBRID_H
+#define SCAN_HYBRID_H
+
+#ifndef _OPENMP
+#error "scan/hybrid.h requires OpenMP"
+#endif
+
+#include "mpi.h"
+#include "openmp.h"
+
+namespace scan {
+
+/* Policy selecting the hybrid backend */
+struct hybrid {
+  mpi processes;   /* communicator and offset exchange between processes */
+  openmp threads;  /* threads and algorithm inside every process */
+
+  explicit hybrid(const mpi& processes = mpi(), const openmp& threads = openmp())
+    : processes(processes), threads(threads) {
+  }
+};
+
+namespace detail {
+
+/*==============================================================
+ * hybrid_scan (inclusive or exclusive scan of the slices of all
+ *              processes; the total is stored in *total if not
+ *              NULL)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename OutIt, typename Op, typename T>
+OutIt hybrid_scan(const hybrid& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                  T* total) {
+  int my_id, nprocs;
+  MPI_Comm_rank(policy.processes.comm, &my_id);
+  MPI_Comm_size(policy.processes.comm, &nprocs);
+
+  const long n = last - first;
+  const openmp::algorithm_t algorithm = policy.threads.algorithm;
+  const bool blocks = algorithm == openmp::scan_then_propagate ||
+                      algorithm == openmp::reduce_then_scan;
+  const bool propagate = algorithm == openmp::scan_then_propagate;
+  const bool stream = use_streaming<T>(policy.threads.stores, n);
+
+  /* partial_sums[tid] holds the total of block tid (block 0 of rank 0 includes init) */
+  padded_slots<T> partial_sums(policy.threads.num_threads());
+  int nthreads = 1;
+
+  /* Scan (scan_then_propagate) or reduce every block; block 0 of rank 0
+     folds in init and is final (an exclusive scan leaves out[pos0] of the
+     other blocks for later) */
+#pragma omp parallel num_threads(policy.threads.num_threads())
+  {
+    int tid = omp_get_thread_num();
+    long pos0, pos1;
+    block_range(n, omp_get_num_threads(), tid, &pos0, &pos1);
+    if( tid == 0 ) nthreads = omp_get_num_threads();
+
+    if( pos0 < pos1 ) {
+      bool final = blocks && my_id == 0 && tid == 0;
+      phase_timer timer(final || propagate ? phase_local_scan : phase_reduce, tid);
+      if( final ) {
+        partial_sums[tid] = scan_block<Exclusive>(first, first+pos1, out, op, init, stream);
+      }
+      else if( propagate ) {
+        T acc = first[pos0];
+        if( !Exclusive ) out[pos0] = acc;
+        partial_sums[tid] = scan_block<Exclusive>(first+pos0+1, first+pos1, out+pos0+1, op, acc);
+      }
+      else {
+        partial_sums[tid] = reduce_serial(first+pos0+1, first+pos1, op, T(first[pos0]));
+      }
+    }
+  }
+
+  /* the blocks past the end of a short slice are empty */
+  carry<T> local;
+  local.valid = (n > 0) || (my_id == 0);
+  local.value = init;
+  if( n > 0 ) {
+    local.value = block_offset(partial_sums, (int)std::min<long>(nthreads, n), op);
+    if( my_id == 0 && !blocks ) local.value = op(init, local.value);
+  }
+
+  /* Get the total of the preceding processes (init on rank 0) */
+  carry<T> offset;
+  offset.valid = 1;
+  offset.value = init;
+  if( nprocs > 1 ) {
+    phase_timer timer(phase_exchange);
+    offset = exchange_offset(policy.processes, my_id, nprocs, local, op);
+    if( my_id == 0 ) offset.value = init;
+  }
+
+  if( n > 0 && !blocks ) {
+    /* the tiles or chunks are scanned once, seeded with the offset */
+    omp_scan<Exclusive>(policy.threads, first, last, out, op, offset.value, (T*)NULL);
+  }
+  else if( n > 0 ) {
+    /* every block but the final one takes the offset of the preceding
+       processes and blocks in one pass: added back (scan_then_propagate)
+       or seeding the scan (reduce_then_scan) */
+#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+    for(int block=0; block<nthreads; ++block) {
+      long pos0, pos1;
+      block_range(n, nthreads, block, &pos0, &pos1);
+      if( pos0 == pos1 || (my_id == 0 && block == 0) ) continue;
+
+      T ps = offset.value;
+      if( block > 0 )
+        ps = my_id == 0 ? block_offset(partial_sums, block, op)
+                        : op(ps, block_offset(partial_sums, block, op));
+
+      int tid = omp_get_thread_num();
+      if( propagate ) {
+        phase_timer timer(phase_add_back, tid);
+        if( Exclusive ) {
+          out[pos0] = ps;
+          add_offset(out+pos0+1, out+pos1, op, ps, stream);
+        }
+        else {
+          add_offset(out+pos0, out+pos1, op, ps, stream);
+        }
+      }
+      else {
+        phase_timer timer(phase_local_scan, tid);
+        scan_block<Exclusive>(first+pos0, first+pos1, out+pos0, op, ps, stream);
+      }
+    }
+  }
+
+  if( total ) {
+    phase_timer timer(phase_total);
+    *total = nprocs == 1 ? local.value
+                         : broadcast_total(policy.processes.comm, nprocs, offset, local, op);
+  }
+  return out + n;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * inclusive_scan / exclusive_scan (hybrid backend, collective
+ *   over policy.processes.comm; the total of the whole sequence
+ *   is stored in *total on every process if not NULL)
+ *==============================================================*/
+template <typename InIt, typename OutIt, typename Op, typename T>
+OutIt inclusive_scan(const hybrid& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                     T* total = NULL) {
+  return detail::hybrid_scan<false>(policy, first, last, out, op, init, total);
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+OutIt exclusive_scan(const hybrid& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                     T* total = NULL) {
+  return detail::hybrid_scan<true>(policy, first, last, out, op, init, total);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_HYBRID_H */
@@ -0,0 +1,117 @@
+/*
+ *  scan/mapped_file.h - Memory-mapped binary files for scan input and output.
+ */
+
+/*---------------------------------------------------------
+ *  Mapped Files (POSIX)
+ *
+ *  A binary file is a flat array of one element type in native byte order,
+ *  with no header.  open_read maps a whole file read-only, create makes (or
+ *  truncates) a file of the given size and maps it read-write, so a scan
+ *  reads its input from and writes its output to the page cache directly:
+ *
+ *    scan::mapped_file in, out;
+ *    if( !in.open_read(path) ) perror(path);
+ *    long n = in.count<int>();
+ *    if( !out.create(outpath, n * sizeof(int)) ) perror(outpath);
+ *    scan::inclusive_scan(policy, in.begin<int>(), in.end<int>(),
+ *                         out.begin<int>(), std::plus<int>(), 0);
+ *
+ *  Errors are reported by a false return with errno set, as with open(2).
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_MAPPED_FILE_H
+#define SCAN_MAPPED_FILE_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace scan {
+
+/*==============================================================
+ * mapped_file (one file mapped in its entirety)
+ *==============================================================*/
+class mapped_file {
+ public:
+  mapped_file() : fd_(-1), addr_(NULL), size_(0) {
+  }
+
+  ~mapped_file() {
+    close();
+  }
+
+  /* Maps an existing file read-only */
+  bool open_read(const char* path) {
+    close();
+    fd_ = ::open(path, O_RDONLY);
+    if( fd_ < 0 ) return false;
+
+    struct stat st;
+    if( fstat(fd_, &st) != 0 ) return fail();
+    size_ = st.st_size;
+    if( size_ == 0 ) return true;  /* mmap rejects empty mappings */
+
+    addr_ = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if( addr_ == MAP_FAILED ) return fail();
+    madvise(addr_, size_, MADV_SEQUENTIAL);
+    return true;
+  }
+
+  /* Creates (or truncates) a file of size bytes and maps it read-write */
+  bool create(const char* path, size_t size) {
+    close();
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if( fd_ < 0 ) return false;
+
+    size_ = size;
+    if( size_ == 0 ) return true;
+    if( ftruncate(fd_, size_) != 0 ) return fail();
+
+    addr_ = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if( addr_ == MAP_FAILED ) return fail();
+    return true;
+  }
+
+  /* Unmaps the file; the changes of a created file reach it at the latest here */
+  void close() {
+    if( addr_ != NULL && addr_ != MAP_FAILED ) munmap(addr_, size_);
+    if( fd_ >= 0 ) ::close(fd_);
+    fd_ = -1;
+    addr_ = NULL;
+    size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+  void* data() { return addr_; }
+  const void* data() const { return addr_; }
+
+  /* Typed view of the file; a trailing partial element is ignored */
+  template <typename T> long count() const { return size_ / sizeof(T); }
+  template <typename T> T* begin() { return static_cast<T*>(addr_); }
+  template <typename T> T* end() { return begin<T>() + count<T>(); }
+
+ private:
+  mapped_file(const mapped_file&);
+  mapped_file& operator=(const mapped_file&);
+
+  /* closes the file on a failed call, keeping its errno */
+  bool fail() {
+    int saved = errno;
+    if( addr_ == MAP_FAILED ) addr_ = NULL;
+    close();
+    errno = saved;
+    return false;
+  }
+
+  int fd_;
+  void* addr_;
+  size_t size_;
+};
+
+} /* namespace scan */
+
+#endif /* SCAN_MAPPED_FILE_H */
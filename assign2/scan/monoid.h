@@ -0,0 +1,127 @@
+/*
+ *  scan/monoid.h - Associative operators with an identity element.
+ */
+
+/*---------------------------------------------------------
+ *  Monoids
+ *
+ *  Every backend scans with any associative operator op; the operator need
+ *  not be commutative.  The functors below also name their identity
+ *  (op(identity(), x) == x), which plain scans do not need but exclusive
+ *  scans and the SIMD kernels do:
+ *
+ *    scan::sum<T>      a + b     0
+ *    scan::product<T>  a * b     1
+ *    scan::minimum<T>  min(a,b)  numeric_limits<T>::max()
+ *    scan::maximum<T>  max(a,b)  numeric_limits<T>::lowest()
+ *    scan::bit_or<T>   a | b     0
+ *    scan::bit_xor<T>  a ^ b     0
+ *    scan::bit_and<T>  a & b     ~0
+ *
+ *  std::plus, std::multiplies, std::bit_or, std::bit_xor and std::bit_and
+ *  are recognized as well.  A user-defined operator either has an identity()
+ *  member or is wrapped with its identity by make_monoid:
+ *
+ *    auto op = scan::make_monoid([](pair a, pair b) { ... }, pair(0, 1));
+ *    scan::inclusive_scan(policy, first, last, out, op, op.identity());
+ *
+ *  Integer sums, products (32-bit), minima, maxima and bitwise operators
+ *  are scanned by the SIMD kernels of scan/simd.h.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_MONOID_H
+#define SCAN_MONOID_H
+
+#include <functional>
+#include <limits>
+
+namespace scan {
+
+template <typename T>
+struct sum {
+  static constexpr T identity() { return T(0); }
+  constexpr T operator()(const T& a, const T& b) const { return a + b; }
+};
+
+template <typename T>
+struct product {
+  static constexpr T identity() { return T(1); }
+  constexpr T operator()(const T& a, const T& b) const { return a * b; }
+};
+
+template <typename T>
+struct minimum {
+  static constexpr T identity() { return std::numeric_limits<T>::max(); }
+  constexpr T operator()(const T& a, const T& b) const { return b < a ? b : a; }
+};
+
+template <typename T>
+struct maximum {
+  static constexpr T identity() { return std::numeric_limits<T>::lowest(); }
+  constexpr T operator()(const T& a, const T& b) const { return a < b ? b : a; }
+};
+
+template <typename T>
+struct bit_or {
+  static constexpr T identity() { return T(0); }
+  constexpr T operator()(const T& a, const T& b) const { return a | b; }
+};
+
+template <typename T>
+struct bit_xor {
+  static constexpr T identity() { return T(0); }
+  constexpr T operator()(const T& a, const T& b) const { return a ^ b; }
+};
+
+template <typename T>
+struct bit_and {
+  static constexpr T identity() { return T(~T(0)); }
+  constexpr T operator()(const T& a, const T& b) const { return a & b; }
+};
+
+/*==============================================================
+ * monoid (a user-defined operator paired with its identity)
+ *==============================================================*/
+template <typename T, typename Op>
+struct monoid {
+  Op op;
+  T id;
+
+  monoid(Op op, const T& id) : op(op), id(id) {
+  }
+
+  T identity() const { return id; }
+  T operator()(const T& a, const T& b) const { return op(a, b); }
+};
+
+template <typename Op, typename T>
+inline monoid<T, Op> make_monoid(Op op, const T& identity) {
+  return monoid<T, Op>(op, identity);
+}
+
+/*==============================================================
+ * identity (identity element of op on T)
+ *==============================================================*/
+template <typename T, typename Op>
+inline T identity(const Op& op) {
+  return op.identity();
+}
+
+template <typename T, typename U>
+inline T identity(const std::plus<U>&) { return T(0); }
+
+template <typename T, typename U>
+inline T identity(const std::multiplies<U>&) { return T(1); }
+
+template <typename T, typename U>
+inline T identity(const std::bit_or<U>&) { return T(0); }
+
+template <typename T, typename U>
+inline T identity(const std::bit_xor<U>&) { return T(0); }
+
+template <typename T, typename U>
+inline T identity(const std::bit_and<U>&) { return T(~T(0)); }
+
+} /* namespace scan */
+
+#endif /* SCAN_MONOID_H */
@@ -0,0 +1,510 @@
+/*
+ *  scan/mpi.h - MPI backend of the prefix scan library.
+ */
+
+/*---------------------------------------------------------
+ *  Parallel Prefix Scan (MPI)
+ *
+ *  Every process of the communicator passes its own slice; the slices
+ *  concatenated in rank order form the global sequence.  init is folded
+ *  in by rank 0 only.
+ *
+ *  1. Each process computes the prefix scan of its slice
+ *  2. The processes exchange the totals of their slices so that each one
+ *     learns the total of the preceding slices (its offset)
+ *  3. All processes but 0 add their offset to their local prefix scan.
+ *
+ *  Exclusive scans follow the same steps; every process but 0 stores its
+ *  offset as its first result.  When the total is requested, the last
+ *  process (which knows it after step 2) broadcasts it.
+ *
+ *  Offset exchange strategies (step 2):
+ *  - linear: all processes send their total to process 0, which scans
+ *    them sequentially and sends every process its offset (O(p) on rank 0)
+ *  - exscan: MPI_Exscan with a user-defined operation
+ *  - recursive_doubling: log2(p) rounds of MPI_Sendrecv with rank +/- 2^k
+ *
+ *  Segmented scans exchange segment carries (scan/segmented.h) the same
+ *  way; a segment may span any number of processes, empty slices included.
+ *
+ *  Reproducible sums (scan/reproducible.h) agree on the grid of the bins
+ *  with an MPI_Allreduce of max |x| and of the counts, then exchange the
+ *  bins of the slices like any other carry.
+ *
+ *  The phase timers (scan/timer.h) of all processes are collected by
+ *  print_phase_report(comm, ...).
+ *
+ *  Values are shipped as raw bytes, so T must be trivially copyable.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_MPI_H
+#define SCAN_MPI_H
+
+#include <mpi.h>
+#include <string.h>
+#include <vector>
+#include "scan.h"
+
+namespace scan {
+
+/* Policy selecting the MPI backend */
+struct mpi {
+  enum exchange_t { linear, exscan, recursive_doubling };
+
+  MPI_Comm comm;
+  exchange_t exchange;
+
+  explicit mpi(MPI_Comm comm = MPI_COMM_WORLD, exchange_t exchange = exscan)
+    : comm(comm), exchange(exchange) {
+  }
+};
+
+/*==============================================================
+ * exchange_name / parse_exchange (names used on command lines)
+ *==============================================================*/
+inline const char* exchange_name(mpi::exchange_t exchange) {
+  switch( exchange ) {
+  case mpi::linear:             return "linear";
+  case mpi::recursive_doubling: return "rd";
+  default:                      return "exscan";
+  }
+}
+
+inline bool parse_exchange(const char* name, mpi::exchange_t* exchange) {
+  if( strcmp(name, "linear") == 0 ) *exchange = mpi::linear;
+  else if( strcmp(name, "exscan") == 0 ) *exchange = mpi::exscan;
+  else if( strcmp(name, "rd") == 0 ) *exchange = mpi::recursive_doubling;
+  else return false;
+  return true;
+}
+
+namespace detail {
+
+/* Carry exchanged between processes, valid is 0 for an empty slice */
+template <typename T>
+struct carry {
+  int valid;
+  T value;
+};
+
+const int scan_tag = 626;
+
+/*==============================================================
+ * combine (carry of the lower ranks, then carry of the higher ones)
+ *==============================================================*/
+template <typename T, typename Op>
+inline carry<T> combine(const carry<T>& lo, const carry<T>& hi, Op op) {
+  if( !lo.valid ) return hi;
+  if( !hi.valid ) return lo;
+  carry<T> r;
+  r.valid = 1;
+  r.value = op(lo.value, hi.value);
+  return r;
+}
+
+/*==============================================================
+ * exchange_linear (gather to rank 0, serial scan, send back)
+ *==============================================================*/
+template <typename T, typename Op>
+carry<T> exchange_linear(MPI_Comm comm, int my_id, int nprocs, const carry<T>& local, Op op) {
+  MPI_Status status;
+  carry<T> offset;
+  offset.valid = 0;  /* nothing precedes rank 0 */
+
+  if( my_id == 0 ) {
+    /* Receive the partial sums and send back the prefix of the preceding ones */
+    std::vector<carry<T> > partial_sums(nprocs);
+    for(int i=1;i<nprocs;++i) {
+      MPI_Recv(&partial_sums[i], sizeof(carry<T>), MPI_BYTE, i, scan_tag, comm, &status);
+    }
+
+    carry<T> prefix = local;
+    for(int i=1;i<nprocs;++i) {
+      MPI_Send(&prefix, sizeof(carry<T>), MPI_BYTE, i, scan_tag, comm);
+      prefix = combine(prefix, partial_sums[i], op);
+    }
+  }
+  else {
+    MPI_Send(const_cast<carry<T>*>(&local), sizeof(carry<T>), MPI_BYTE, 0, scan_tag, comm);
+    MPI_Recv(&offset, sizeof(carry<T>), MPI_BYTE, 0, scan_tag, comm, &status);
+  }
+  return offset;
+}
+
+/*==============================================================
+ * exchange_exscan (MPI_Exscan with a user-defined operation)
+ *   MPI calls back a plain function, so the operator in use is
+ *   reached through a per-type pointer set around the call.
+ *   The datatype and the MPI_Op are created on first use and
+ *   kept until MPI_Finalize.
+ *==============================================================*/
+template <typename T, typename Op>
+struct exscan_op {
+  static const Op* current;
+
+  static void apply(void* invec, void* inoutvec, int* len, MPI_Datatype*) {
+    const carry<T>* in = static_cast<const carry<T>*>(invec);
+    carry<T>* inout = static_cast<carry<T>*>(inoutvec);
+    for(int i=0;i<*len;++i) inout[i] = combine(in[i], inout[i], *current);
+  }
+
+  static MPI_Datatype datatype() {
+    static const MPI_Datatype type = make_datatype();
+    return type;
+  }
+
+  static MPI_Op mpi_op() {
+    static const MPI_Op op = make_op();
+    return op;
+  }
+
+ private:
+  static MPI_Datatype make_datatype() {
+    MPI_Datatype type;
+    MPI_Type_contiguous(sizeof(carry<T>), MPI_BYTE, &type);
+    MPI_Type_commit(&type);
+    return type;
+  }
+
+  static MPI_Op make_op() {
+    MPI_Op op;
+    MPI_Op_create(&apply, 0 /* not commutative */, &op);
+    return op;
+  }
+};
+
+template <typename T, typename Op>
+const Op* exscan_op<T, Op>::current = NULL;
+
+template <typename T, typename Op>
+carry<T> exchange_exscan(MPI_Comm comm, const carry<T>& local, Op op) {
+  exscan_op<T, Op>::current = &op;
+
+  carry<T> offset;
+  MPI_Exscan(const_cast<carry<T>*>(&local), &offset, 1, exscan_op<T, Op>::datatype(),
+             exscan_op<T, Op>::mpi_op(), comm);
+
+  /* MPI_Exscan leaves the result of rank 0 undefined */
+  int my_id;
+  MPI_Comm_rank(comm, &my_id);
+  if( my_id == 0 ) offset.valid = 0;
+
+  exscan_op<T, Op>::current = NULL;
+  return offset;
+}
+
+/*==============================================================
+ * exchange_recursive_doubling (log2(p) rounds; in round k every
+ *   process sends its running total to rank+2^k and folds the
+ *   one received from rank-2^k)
+ *==============================================================*/
+template <typename T, typename Op>
+carry<T> exchange_recursive_doubling(MPI_Comm comm, int my_id, int nprocs,
+                                     const carry<T>& local, Op op) {
+  MPI_Status status;
+  carry<T> total = local;   /* fold of ranks my_id-2^k+1 .. my_id */
+  carry<T> offset;          /* fold of ranks my_id-2^k+1 .. my_id-1 */
+  offset.valid = 0;
+
+  for(int dist=1; dist<nprocs; dist<<=1) {
+    int dest = (my_id + dist < nprocs) ? my_id + dist : MPI_PROC_NULL;
+    int source = (my_id - dist >= 0) ? my_id - dist : MPI_PROC_NULL;
+
+    carry<T> received;
+    MPI_Sendrecv(&total, sizeof(carry<T>), MPI_BYTE, dest, scan_tag,
+                 &received, sizeof(carry<T>), MPI_BYTE, source, scan_tag,
+                 comm, &status);
+
+    if( source != MPI_PROC_NULL ) {
+      offset = combine(received, offset, op);
+      total = combine(received, total, op);
+    }
+  }
+  return offset;
+}
+
+/*==============================================================
+ * exchange_offset (total of the preceding processes with the
+ *   strategy selected by the policy; invalid on rank 0, which
+ *   no process precedes)
+ *==============================================================*/
+template <typename T, typename Op>
+carry<T> exchange_offset(const mpi& policy, int my_id, int nprocs, const carry<T>& local, Op op) {
+  switch( policy.exchange ) {
+  case mpi::linear:
+    return exchange_linear(policy.comm, my_id, nprocs, local, op);
+  case mpi::recursive_doubling:
+    return exchange_recursive_doubling(policy.comm, my_id, nprocs, local, op);
+  default:
+    return exchange_exscan(policy.comm, local, op);
+  }
+}
+
+/*==============================================================
+ * broadcast_total (total of all processes, known to the last
+ *                  one from its offset and its own total)
+ *==============================================================*/
+template <typename T, typename Op>
+T broadcast_total(MPI_Comm comm, int nprocs, const carry<T>& offset, const carry<T>& local,
+                  Op op) {
+  carry<T> total = combine(offset, local, op);
+  MPI_Bcast(&total, sizeof(carry<T>), MPI_BYTE, nprocs-1, comm);
+  return total.value;
+}
+
+/*==============================================================
+ * mpi_scan (inclusive or exclusive scan of the slices of all
+ *           processes; the total is stored in *total if not NULL)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename OutIt, typename Op, typename T>
+OutIt mpi_scan(const mpi& policy, InIt first, InIt last, OutIt out, Op op, T init, T* total) {
+  int my_id, nprocs;
+  MPI_Comm_rank(policy.comm, &my_id);
+  MPI_Comm_size(policy.comm, &nprocs);
+
+  const long n = last - first;
+
+  /* Compute the local prefix scan, rank 0 also folds in init
+     (an exclusive scan leaves out[0] of the other ranks for later) */
+  carry<T> local;
+  local.valid = (n > 0) || (my_id == 0);
+  local.value = init;
+  if( my_id == 0 ) {
+    phase_timer timer(phase_local_scan);
+    local.value = scan_block<Exclusive>(first, last, out, op, init);
+  }
+  else if( n > 0 ) {
+    phase_timer timer(phase_local_scan);
+    T acc = *first;
+    if( !Exclusive ) *out = acc;
+    local.value = scan_block<Exclusive>(first+1, last, out+1, op, acc);
+  }
+
+  if( nprocs == 1 ) {
+    if( total ) *total = local.value;
+    return out + n;
+  }
+
+  /* Get the total of the preceding processes */
+  carry<T> offset;
+  {
+    phase_timer timer(phase_exchange);
+    offset = exchange_offset(policy, my_id, nprocs, local, op);
+  }
+
+  /* add back the prefix of the preceding processes */
+  if( my_id > 0 && n > 0 ) {
+    phase_timer timer(phase_add_back);
+    if( Exclusive ) {
+      out[0] = offset.value;
+      add_offset(out+1, out+n, op, offset.value);
+    }
+    else {
+      add_offset(out, out+n, op, offset.value);
+    }
+  }
+
+  if( total ) {
+    phase_timer timer(phase_total);
+    *total = broadcast_total(policy.comm, nprocs, offset, local, op);
+  }
+  return out + n;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * inclusive_scan / exclusive_scan (MPI backend, collective over
+ *   policy.comm; the total of the whole sequence is stored in
+ *   *total on every process if not NULL)
+ *==============================================================*/
+template <typename InIt, typename OutIt, typename Op, typename T>
+OutIt inclusive_scan(const mpi& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                     T* total = NULL) {
+  return detail::mpi_scan<false>(policy, first, last, out, op, init, total);
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+OutIt exclusive_scan(const mpi& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                     T* total = NULL) {
+  return detail::mpi_scan<true>(policy, first, last, out, op, init, total);
+}
+
+namespace detail {
+
+/*==============================================================
+ * mpi_segmented_scan (segmented scan of the slices of all
+ *                     processes, collective over policy.comm)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+OutIt mpi_segmented_scan(const mpi& policy, InIt first, InIt last, FlagIt flags, OutIt out,
+                         Op op, T init) {
+  int my_id, nprocs;
+  MPI_Comm_rank(policy.comm, &my_id);
+  MPI_Comm_size(policy.comm, &nprocs);
+
+  const long n = last - first;
+
+  /* Scan the local slice, rank 0 starts the first segment */
+  carry<segment<T> > local;
+  local.valid = (n > 0) || (my_id == 0);
+  local.value.head = 1;
+  local.value.value = init;
+  long first_head = 0;
+  if( n > 0 ) {
+    phase_timer timer(phase_local_scan);
+    first_head = segmented_block<Exclusive>(first, flags, out, 0L, n, op, init, my_id == 0,
+                                            &local.value);
+  }
+
+  if( nprocs == 1 ) return out + n;
+
+  /* Get the segment carry of the preceding processes */
+  carry<segment<T> > offset;
+  {
+    phase_timer timer(phase_exchange);
+    offset = exchange_offset(policy, my_id, nprocs, local, segment_op<Op>(op));
+  }
+
+  /* only the elements before the first head continue a preceding segment */
+  if( my_id > 0 ) {
+    phase_timer timer(phase_add_back);
+    segmented_fixup<Exclusive>(out, 0L, first_head, op, offset.value.value);
+  }
+
+  return out + n;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * segmented_inclusive_scan / segmented_exclusive_scan
+ *   (MPI backend, segments given by the flags of the local slice,
+ *    collective over policy.comm)
+ *==============================================================*/
+template <typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+OutIt segmented_inclusive_scan(const mpi& policy, InIt first, InIt last, FlagIt flags,
+                               OutIt out, Op op, T init) {
+  return detail::mpi_segmented_scan<false>(policy, first, last, flags, out, op, init);
+}
+
+template <typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+OutIt segmented_exclusive_scan(const mpi& policy, InIt first, InIt last, FlagIt flags,
+                               OutIt out, Op op, T init) {
+  return detail::mpi_segmented_scan<true>(policy, first, last, flags, out, op, init);
+}
+
+namespace detail {
+
+/*==============================================================
+ * mpi_reproducible_grid (grid of the bins of the slices of all
+ *                        processes)
+ *==============================================================*/
+template <typename InIt>
+bin_grid mpi_reproducible_grid(MPI_Comm comm, InIt first, InIt last) {
+  double local_max = max_abs_serial(first, last, 0.0), m = 0.0;
+  long n = last - first, numints = 0;
+  MPI_Allreduce(&local_max, &m, 1, MPI_DOUBLE, MPI_MAX, comm);
+  MPI_Allreduce(&n, &numints, 1, MPI_LONG, MPI_SUM, comm);
+  return make_bin_grid(m, numints);
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * reproducible_inclusive_scan / reproducible_reduce (MPI
+ *   backend, collective over policy.comm; the same bits for any
+ *   number of processes and any slices)
+ *==============================================================*/
+template <typename InIt, typename OutIt>
+OutIt reproducible_inclusive_scan(const mpi& policy, InIt first, InIt last, OutIt out,
+                                  typename std::iterator_traits<InIt>::value_type* total = NULL) {
+  typedef typename std::iterator_traits<InIt>::value_type T;
+  int my_id, nprocs;
+  MPI_Comm_rank(policy.comm, &my_id);
+  MPI_Comm_size(policy.comm, &nprocs);
+
+  bin_grid g = detail::mpi_reproducible_grid(policy.comm, first, last);
+
+  /* bins of the slice, then of the preceding slices */
+  detail::carry<bins> local, offset;
+  local.valid = 1;
+  local.value = detail::reduce_bins(first, last, g);
+  offset.valid = 1;
+  offset.value.hi = offset.value.lo = 0;
+  if( nprocs > 1 ) {
+    offset = detail::exchange_offset(policy, my_id, nprocs, local, bins_plus());
+    if( my_id == 0 ) offset.value.hi = offset.value.lo = 0;
+  }
+
+  detail::reproducible_block(first, last, out, offset.value, g);
+
+  if( total ) {
+    bins sum = local.value;
+    if( nprocs > 1 ) sum = detail::broadcast_total(policy.comm, nprocs, offset, local, bins_plus());
+    *total = from_bins<T>(sum, g);
+  }
+  return out + (last - first);
+}
+
+template <typename InIt>
+typename std::iterator_traits<InIt>::value_type
+reproducible_reduce(const mpi& policy, InIt first, InIt last) {
+  typedef typename std::iterator_traits<InIt>::value_type T;
+  bin_grid g = detail::mpi_reproducible_grid(policy.comm, first, last);
+
+  /* integer sums: exact, so the order of MPI_Allreduce does not matter */
+  bins local = detail::reduce_bins(first, last, g), sum;
+  MPI_Allreduce(&local, &sum, 2, MPI_INT64_T, MPI_SUM, policy.comm);
+  return from_bins<T>(sum, g);
+}
+
+/*==============================================================
+ * print_phase_report (statistics over the threads of every
+ *   process, printed by rank 0 to f; collective over comm)
+ *==============================================================*/
+inline void print_phase_report(MPI_Comm comm, FILE* f, double niterations) {
+  int my_id, nprocs;
+  MPI_Comm_rank(comm, &my_id);
+  MPI_Comm_size(comm, &nprocs);
+
+  /* rows are shipped as raw bytes */
+  const int row_bytes = sizeof(detail::timer_row);
+  int bytes = detail::timer_rows_used() * row_bytes;
+  std::vector<int> counts(nprocs), displs(nprocs);
+  MPI_Gather(&bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+  std::vector<detail::timer_row> rows;
+  int nrows = 0;
+  if( my_id == 0 ) {
+    for(int i=0;i<nprocs;++i) {
+      displs[i] = nrows * row_bytes;
+      nrows += counts[i] / row_bytes;
+    }
+    rows.resize(std::max(nrows, 1));
+  }
+  MPI_Gatherv(detail::timer_rows(), bytes, MPI_BYTE, rows.data(), counts.data(), displs.data(),
+              MPI_BYTE, 0, comm);
+
+  if( my_id == 0 && f ) detail::write_phase_report(f, rows.data(), nrows, niterations);
+}
+
+/*==============================================================
+ * write_phase_report (print_phase_report by rank 0 to path, "-"
+ *   for stdout; collective over comm)
+ *==============================================================*/
+inline void write_phase_report(MPI_Comm comm, const char* path, double niterations) {
+  int my_id;
+  MPI_Comm_rank(comm, &my_id);
+  FILE* f = NULL;
+  if( my_id == 0 ) {
+    f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if( !f ) perror(path);
+  }
+  print_phase_report(comm, f, niterations);
+  if( f && f != stdout ) fclose(f);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_MPI_H */
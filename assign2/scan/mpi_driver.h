@@ -0,0 +1,223 @@
+/*
+ *  scan/mpi_driver.h - Timed loop and checks shared by the MPI programs.
+ */
+
+/*---------------------------------------------------------
+ *  MPI Driver Loop
+ *
+ *  prefixsum_mpi (scan::mpi) and prefixsum_hybrid (scan::hybrid) time the
+ *  same loop with different policies:
+ *
+ *  1. rank 0 scatters the sequence (MPI_Scatterv), unless every process
+ *     already holds its slice,
+ *  2. every process scans its slice, a barrier after each iteration,
+ *  3. the prefix sums are gathered on rank 0 and checked against a serial
+ *     sum there (report_gathered), or checked where they are
+ *     (verify_distributed).
+ *
+ *  Slices follow the balanced partition of block_range.  Inputs are int
+ *  or long (int32 random ints, int64 files), sums are long.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_MPI_DRIVER_H
+#define SCAN_MPI_DRIVER_H
+
+#include <mpi.h>
+#include <sys/time.h>
+#include <vector>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include "mpi.h"
+#include "timer.h"
+
+namespace scan {
+
+namespace detail {
+
+template <typename T> inline MPI_Datatype mpi_datatype();
+template <> inline MPI_Datatype mpi_datatype<int>() { return MPI_INT; }
+template <> inline MPI_Datatype mpi_datatype<long>() { return MPI_LONG; }
+
+} /* namespace detail */
+
+/*==============================================================
+ * slice_layout (counts and displacements of the slices of all
+ *               processes, for MPI_Scatterv and MPI_Gatherv)
+ *==============================================================*/
+inline void slice_layout(long numints, int nprocs, std::vector<int>& counts,
+                         std::vector<int>& displs) {
+  counts.resize(nprocs);
+  displs.resize(nprocs);
+  for(int i=0;i<nprocs;++i) {
+    long pos0, pos1;
+    block_range(numints, nprocs, i, &pos0, &pos1);
+    counts[i] = pos1 - pos0;
+    displs[i] = pos0;
+  }
+}
+
+/*==============================================================
+ * scan_slice (inclusive or exclusive prefix sum of the local
+ *             slices; returns the total of the whole sequence)
+ *==============================================================*/
+template <typename Policy, typename In>
+long scan_slice(const Policy& policy, const std::vector<In>& input,
+                std::vector<long>& prefix_sums, bool exclusive) {
+  long total = 0;
+  if( exclusive )
+    exclusive_scan(policy, input.begin(), input.end(), prefix_sums.begin(),
+                   std::plus<long>(), 0L, &total);
+  else
+    inclusive_scan(policy, input.begin(), input.end(), prefix_sums.begin(),
+                   std::plus<long>(), 0L, &total);
+  return total;
+}
+
+/*==============================================================
+ * time_scans (numiterations scatters of sendbuf from rank 0
+ *   into input, none if counts is empty, each followed by a
+ *   scan of the slices; returns the usec per scan, adds the
+ *   usec of the scatters to *scatter_usec and stores the total
+ *   in *total; collective over comm)
+ *==============================================================*/
+template <typename Policy, typename In>
+double time_scans(const Policy& policy, MPI_Comm comm, const std::vector<In>& sendbuf,
+                  const std::vector<int>& counts, const std::vector<int>& displs,
+                  std::vector<In>& input, std::vector<long>& prefix_sums, bool exclusive,
+                  int numiterations, long* scatter_usec, long* total) {
+  struct timeval start, end;   /* gettimeofday stuff */
+  long totalTime = 0;
+
+  for(int iteration=0; iteration < numiterations; ++iteration) {
+    if( !counts.empty() ) {
+      /* Pass the input sequence to all processors */
+      gettimeofday(&start, NULL);
+      {
+        phase_timer timer(phase_scatter);
+        MPI_Scatterv(const_cast<In*>(sendbuf.data()), const_cast<int*>(counts.data()),
+                     const_cast<int*>(displs.data()), detail::mpi_datatype<In>(),
+                     input.data(), input.size(), detail::mpi_datatype<In>(), 0, comm);
+      }
+
+      /* Make sure everybody gets the data */
+      MPI_Barrier(comm);
+      gettimeofday(&end, NULL);
+      *scatter_usec += elapsed(&start, &end);
+    }
+
+    gettimeofday(&start, NULL);
+
+    /* Compute the prefix sum of the distributed sequence */
+    *total = scan_slice(policy, input, prefix_sums, exclusive);
+
+    /* Make sure every node finishes the computation */
+    MPI_Barrier(comm);
+    gettimeofday(&end, NULL);
+    totalTime += elapsed(&start, &end);
+  }
+  return totalTime / (double)numiterations;
+}
+
+/*==============================================================
+ * gather_slices (prefix sums of all processes into results on
+ *                rank 0; returns the usec it took)
+ *==============================================================*/
+inline long gather_slices(MPI_Comm comm, std::vector<long>& prefix_sums,
+                          std::vector<long>& results, const std::vector<int>& counts,
+                          const std::vector<int>& displs) {
+  struct timeval start, end;   /* gettimeofday stuff */
+  gettimeofday(&start, NULL);
+  {
+    phase_timer timer(phase_gather);
+    MPI_Gatherv(prefix_sums.data(), prefix_sums.size(), MPI_LONG, results.data(),
+                const_cast<int*>(counts.data()), const_cast<int*>(displs.data()), MPI_LONG,
+                0, comm);
+  }
+  gettimeofday(&end, NULL);
+  return elapsed(&start, &end);
+}
+
+/*==============================================================
+ * verify_distributed (checks a distributed inclusive or
+ *                     exclusive prefix sum and its total against
+ *                     the local input; true on all ranks iff
+ *                     every slice and every total is correct)
+ *==============================================================*/
+template <typename In>
+bool verify_distributed(const std::vector<In>& input, const std::vector<long>& prefix_sums,
+                        bool exclusive, long total, MPI_Comm comm) {
+  int my_id;
+  MPI_Comm_rank(comm, &my_id);
+
+  /* total of the input of the preceding processes, and of all of them */
+  long local_sum = std::accumulate(input.begin(), input.end(), 0L);
+  long offset = 0, global_sum = 0;
+  MPI_Exscan(&local_sum, &offset, 1, MPI_LONG, MPI_SUM, comm);
+  MPI_Allreduce(&local_sum, &global_sum, 1, MPI_LONG, MPI_SUM, comm);
+  if( my_id == 0 ) offset = 0;
+
+  int passed = total == global_sum;
+  for(size_t i=0;i<input.size();++i) {
+    if( exclusive && prefix_sums[i] != offset ) passed = 0;
+    offset += input[i];
+    if( !exclusive && prefix_sums[i] != offset ) passed = 0;
+  }
+
+  int all_passed;
+  MPI_Allreduce(&passed, &all_passed, 1, MPI_INT, MPI_MIN, comm);
+  return all_passed != 0;
+}
+
+/*==============================================================
+ * report_gathered (rank 0: prints the sequences if asked, then
+ *   PASSED or FAILED against a serial sum of the input, and
+ *   with write_outputs the wrong sums; true iff passed)
+ *==============================================================*/
+template <typename In>
+bool report_gathered(const std::vector<In>& input, const std::vector<long>& results,
+                     bool exclusive, long total, bool write_outputs) {
+  std::ostream_iterator<long> out_it(std::cout, " ");
+  if( write_outputs ) {
+    std::cout << "Input sequence: " << std::endl;
+    std::copy(input.begin(), input.end(), out_it);
+    std::cout << std::endl;
+
+    std::cout << "Prefix sums: " << std::endl;
+    std::copy(results.begin(), results.end(), out_it);
+    std::cout << std::endl;
+  }
+
+  /* Verify the result */
+  std::vector<long> result_gold(input.begin(), input.end());  /* sum in long */
+  std::partial_sum(result_gold.begin(), result_gold.end(), result_gold.begin());
+  long gold_total = result_gold.empty() ? 0 : result_gold.back();
+  if( exclusive ) {
+    result_gold.insert(result_gold.begin(), 0L);
+    result_gold.pop_back();
+  }
+  if( total == gold_total &&
+      std::equal(result_gold.begin(), result_gold.end(), results.begin()) ) {
+    std::cout << "PASSED." << std::endl;
+    return true;
+  }
+
+  std::cout << "FAILED." << std::endl;
+  if( write_outputs ) {
+    std::cout << "Reference prefix sum: ";
+    std::copy(result_gold.begin(), result_gold.end(), out_it);
+    std::cout << std::endl;
+    for(size_t i=0;i<result_gold.size();++i) {
+      if( result_gold[i] != results[i] ) {
+        std::cout << i << "\t" << results[i] << "\t" << result_gold[i] << std::endl;
+      }
+    }
+  }
+  return false;
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_MPI_DRIVER_H */
@@ -0,0 +1,120 @@
+/*
+ *  scan/mpi_io.h - Collective MPI-IO of the slices of a distributed array.
+ */
+
+/*---------------------------------------------------------
+ *  Distributed Binary Files (MPI-IO)
+ *
+ *  The file is a flat array of T in native byte order.  Every process
+ *  reads or writes only its own slice [first, first+count) at byte offset
+ *  first*sizeof(T), with the collective MPI_File_read_at_all and
+ *  MPI_File_write_at_all, so no process handles the data of another one.
+ *
+ *  MPI counts are ints, so slices are transferred in rounds of at most
+ *  io_chunk bytes; all processes take part in the same number of rounds
+ *  (empty ones included), as collective calls require.
+ *
+ *  The functions are collective over comm and return an MPI error code.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_MPI_IO_H
+#define SCAN_MPI_IO_H
+
+#include <mpi.h>
+#include <algorithm>
+
+namespace scan {
+
+namespace detail {
+
+const long io_chunk = 1L << 30;  /* bytes per collective call */
+
+/*==============================================================
+ * io_rounds (number of collective calls every process must make
+ *            for the largest slice)
+ *==============================================================*/
+inline long io_rounds(MPI_Comm comm, long bytes) {
+  long rounds = (bytes + io_chunk - 1) / io_chunk;
+  long max_rounds = 0;
+  MPI_Allreduce(&rounds, &max_rounds, 1, MPI_LONG, MPI_MAX, comm);
+  return max_rounds;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * file_count (number of elements of T in the file, on every
+ *             process)
+ *==============================================================*/
+template <typename T>
+int file_count(MPI_Comm comm, const char* path, long* count) {
+  MPI_File fh;
+  int err = MPI_File_open(comm, const_cast<char*>(path), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+  if( err != MPI_SUCCESS ) return err;
+
+  MPI_Offset size = 0;
+  err = MPI_File_get_size(fh, &size);
+  *count = size / sizeof(T);
+  MPI_File_close(&fh);
+  return err;
+}
+
+/*==============================================================
+ * read_slice (reads elements [first, first+count) of the file
+ *             into buf)
+ *==============================================================*/
+template <typename T>
+int read_slice(MPI_Comm comm, const char* path, long first, long count, T* buf) {
+  MPI_File fh;
+  int err = MPI_File_open(comm, const_cast<char*>(path), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+  if( err != MPI_SUCCESS ) return err;
+
+  const long bytes = count * sizeof(T);
+  const long rounds = detail::io_rounds(comm, bytes);
+  for(long r=0; r<rounds; ++r) {
+    long done = std::min(r * detail::io_chunk, bytes);
+    long len = std::min(detail::io_chunk, bytes - done);
+    MPI_Status status;
+    int e = MPI_File_read_at_all(fh, first * sizeof(T) + done, (char*)buf + done, (int)len,
+                                 MPI_BYTE, &status);
+    if( err == MPI_SUCCESS ) err = e;  /* keep going, the others are in the call */
+  }
+
+  MPI_File_close(&fh);
+  return err;
+}
+
+/*==============================================================
+ * write_slice (writes buf as elements [first, first+count) of
+ *              the file, created if needed)
+ *==============================================================*/
+template <typename T>
+int write_slice(MPI_Comm comm, const char* path, long first, long count, const T* buf) {
+  MPI_File fh;
+  int err = MPI_File_open(comm, const_cast<char*>(path), MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                          MPI_INFO_NULL, &fh);
+  if( err != MPI_SUCCESS ) return err;
+
+  /* drop whatever an older, longer file had past the end */
+  const long bytes = count * sizeof(T);
+  long total = 0;
+  MPI_Allreduce(const_cast<long*>(&bytes), &total, 1, MPI_LONG, MPI_SUM, comm);
+  err = MPI_File_set_size(fh, total);
+
+  const long rounds = detail::io_rounds(comm, bytes);
+  for(long r=0; r<rounds; ++r) {
+    long done = std::min(r * detail::io_chunk, bytes);
+    long len = std::min(detail::io_chunk, bytes - done);
+    MPI_Status status;
+    int e = MPI_File_write_at_all(fh, first * sizeof(T) + done, (char*)buf + done, (int)len,
+                                  MPI_BYTE, &status);
+    if( err == MPI_SUCCESS ) err = e;
+  }
+
+  MPI_File_close(&fh);
+  return err;
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_MPI_IO_H */
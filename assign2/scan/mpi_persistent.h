@@ -0,0 +1,226 @@
+/*
+ *  scan/mpi_persistent.h - Repeated MPI scans with persistent requests.
+ */
+
+/*---------------------------------------------------------
+ *  Persistent Scatter + Scan
+ *
+ *  persistent_scan sets up, once, every message of a scatter from rank 0
+ *  and of an inclusive or exclusive scan of the slices, as persistent
+ *  requests (MPI_Send_init / MPI_Recv_init).  Each run() restarts them
+ *  (MPI_Start / MPI_Startall) on the same buffers:
+ *
+ *  1. Rank 0 starts the sends of the slices and copies its own; every
+ *     other process waits for its slice.
+ *  2. Each process scans its slice.
+ *  3. The offsets are exchanged by recursive doubling, one pair of
+ *     persistent requests per round.
+ *  4. The total is broadcast from the last process down a binomial tree,
+ *     then the offsets are added back.
+ *
+ *  No step waits for more than the messages it needs, so there is no
+ *  global barrier: runs pipeline across processes, as far as their data
+ *  allow.  With counts == NULL (on every process, or none) the slices are
+ *  already in place and step 1 is skipped.
+ *
+ *  The buffers passed to the constructor are reused by every run() and
+ *  must outlive the object, which must be destroyed before MPI_Finalize.
+ *  Values are shipped as raw bytes, so In and T must be trivially copyable.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_MPI_PERSISTENT_H
+#define SCAN_MPI_PERSISTENT_H
+
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+#include "mpi.h"
+
+namespace scan {
+
+namespace detail {
+
+const int slice_tag = 628;
+const int round_tag = 629;
+const int total_tag = 630;
+
+} /* namespace detail */
+
+template <typename In, typename T, typename Op>
+class persistent_scan {
+ public:
+  /* sendbuf and displs, and the values of counts, are significant on
+     rank 0 only, as for MPI_Scatterv; slice and out hold the n elements
+     of this process */
+  persistent_scan(const mpi& policy, const In* sendbuf, const int* counts, const int* displs,
+                  In* slice, long n, T* out, Op op, T init, bool exclusive = false)
+    : comm_(policy.comm), sendbuf_(NULL), slice_(slice), n_(n), out_(out), op_(op),
+      init_(init), exclusive_(exclusive) {
+    MPI_Comm_rank(comm_, &my_id_);
+    MPI_Comm_size(comm_, &nprocs_);
+    MPI_Type_contiguous(sizeof(In), MPI_BYTE, &elem_type_);
+    MPI_Type_commit(&elem_type_);
+
+    /* 1. slices */
+    if( counts && my_id_ == 0 ) {
+      sendbuf_ = sendbuf + displs[0];
+      for(int i=1;i<nprocs_;++i) {
+        scatter_.push_back(MPI_REQUEST_NULL);
+        MPI_Send_init(const_cast<In*>(sendbuf + displs[i]), counts[i], elem_type_, i,
+                      detail::slice_tag, comm_, &scatter_.back());
+      }
+    }
+    else if( counts && my_id_ > 0 ) {
+      scatter_.push_back(MPI_REQUEST_NULL);
+      MPI_Recv_init(slice, n, elem_type_, 0, detail::slice_tag, comm_, &scatter_.back());
+    }
+
+    /* 3. recursive doubling: in round k, send to rank+2^k, receive from rank-2^k */
+    int rounds = 0;
+    while( (1 << rounds) < nprocs_ ) ++rounds;
+    sent_.resize(rounds);
+    received_.resize(rounds);
+    round_send_.resize(rounds);
+    round_recv_.resize(rounds);
+    for(int k=0;k<rounds;++k) {
+      int dist = 1 << k;
+      int dest = (my_id_ + dist < nprocs_) ? my_id_ + dist : MPI_PROC_NULL;
+      int source = (my_id_ - dist >= 0) ? my_id_ - dist : MPI_PROC_NULL;
+      MPI_Send_init(&sent_[k], sizeof(detail::carry<T>), MPI_BYTE, dest, detail::round_tag,
+                    comm_, &round_send_[k]);
+      MPI_Recv_init(&received_[k], sizeof(detail::carry<T>), MPI_BYTE, source,
+                    detail::round_tag, comm_, &round_recv_[k]);
+    }
+
+    /* 4. binomial tree rooted at the last process (relative rank 0) */
+    int rel = (my_id_ + 1) % nprocs_;
+    int low = rel ? (rel & -rel) : nprocs_;  /* children are rel+m, m < low */
+    int parent = rel ? (rel - low + nprocs_ - 1) % nprocs_ : MPI_PROC_NULL;
+    MPI_Recv_init(&total_, sizeof(detail::carry<T>), MPI_BYTE, parent, detail::total_tag,
+                  comm_, &total_recv_);
+    for(int m=1; m<low && rel+m<nprocs_; m<<=1) {
+      total_send_.push_back(MPI_REQUEST_NULL);
+      MPI_Send_init(&total_, sizeof(detail::carry<T>), MPI_BYTE, (rel + m + nprocs_ - 1) % nprocs_,
+                    detail::total_tag, comm_, &total_send_.back());
+    }
+  }
+
+  ~persistent_scan() {
+    free_all(scatter_);
+    free_all(round_send_);
+    free_all(round_recv_);
+    free_all(total_send_);
+    MPI_Request_free(&total_recv_);
+    MPI_Type_free(&elem_type_);
+  }
+
+  /*==============================================================
+   * run (one scatter and scan; returns the total of the sequence)
+   *==============================================================*/
+  T run() {
+    /* 1. Get the slice */
+    if( !scatter_.empty() || sendbuf_ ) {
+      phase_timer timer(phase_scatter);
+      if( !scatter_.empty() ) MPI_Startall(scatter_.size(), scatter_.data());
+      if( sendbuf_ ) std::copy(sendbuf_, sendbuf_ + n_, slice_);
+      if( my_id_ > 0 ) MPI_Wait(&scatter_[0], MPI_STATUS_IGNORE);
+    }
+
+    /* 2. Compute the local prefix scan, rank 0 also folds in init
+          (an exclusive scan leaves out[0] of the other ranks for later) */
+    detail::carry<T> local;
+    local.valid = (n_ > 0) || (my_id_ == 0);
+    local.value = init_;
+    if( my_id_ == 0 ) {
+      phase_timer timer(phase_local_scan);
+      local.value = scan_range(slice_, slice_ + n_, out_, init_);
+    }
+    else if( n_ > 0 ) {
+      phase_timer timer(phase_local_scan);
+      T acc = slice_[0];
+      if( !exclusive_ ) out_[0] = acc;
+      local.value = scan_range(slice_ + 1, slice_ + n_, out_ + 1, acc);
+    }
+
+    /* 3. Get the total of the preceding processes */
+    detail::carry<T> total = local;
+    detail::carry<T> offset;
+    offset.valid = 0;
+    for(int k=0;k<(int)sent_.size();++k) {
+      phase_timer timer(phase_exchange);
+      sent_[k] = total;
+      MPI_Start(&round_send_[k]);
+      MPI_Start(&round_recv_[k]);
+      MPI_Wait(&round_recv_[k], MPI_STATUS_IGNORE);
+      if( my_id_ - (1 << k) >= 0 ) {
+        offset = detail::combine(received_[k], offset, op_);
+        total = detail::combine(received_[k], total, op_);
+      }
+    }
+
+    /* 4. Pass the total down the tree, then add back the offset */
+    if( my_id_ == nprocs_ - 1 ) total_ = total;
+    {
+      phase_timer timer(phase_total);
+      MPI_Start(&total_recv_);
+      MPI_Wait(&total_recv_, MPI_STATUS_IGNORE);
+      if( !total_send_.empty() ) MPI_Startall(total_send_.size(), total_send_.data());
+    }
+
+    if( my_id_ > 0 && n_ > 0 ) {
+      phase_timer timer(phase_add_back);
+      if( exclusive_ ) {
+        out_[0] = offset.value;
+        detail::add_offset(out_ + 1, out_ + n_, op_, offset.value);
+      }
+      else {
+        detail::add_offset(out_, out_ + n_, op_, offset.value);
+      }
+    }
+
+    /* the buffers of the sends are reused by the next run */
+    wait_all(total_send_);
+    wait_all(round_send_);
+    if( my_id_ == 0 ) wait_all(scatter_);
+    return total_.value;
+  }
+
+ private:
+  persistent_scan(const persistent_scan&);
+  persistent_scan& operator=(const persistent_scan&);
+
+  T scan_range(const In* first, const In* last, T* out, T acc) {
+    if( exclusive_ ) return detail::scan_block<true>(first, last, out, op_, acc);
+    return detail::scan_block<false>(first, last, out, op_, acc);
+  }
+
+  static void wait_all(std::vector<MPI_Request>& requests) {
+    if( !requests.empty() ) MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+  }
+
+  static void free_all(std::vector<MPI_Request>& requests) {
+    for(size_t i=0;i<requests.size();++i) MPI_Request_free(&requests[i]);
+  }
+
+  MPI_Comm comm_;
+  int my_id_, nprocs_;
+  const In* sendbuf_;   /* rank 0's own slice in the scattered sequence */
+  In* slice_;
+  long n_;
+  T* out_;
+  Op op_;
+  T init_;
+  bool exclusive_;
+  MPI_Datatype elem_type_;
+
+  std::vector<MPI_Request> scatter_;
+  std::vector<detail::carry<T> > sent_, received_;
+  std::vector<MPI_Request> round_send_, round_recv_;
+  detail::carry<T> total_;
+  MPI_Request total_recv_;
+  std::vector<MPI_Request> total_send_;
+};
+
+} /* namespace scan */
+
+#endif /* SCAN_MPI_PERSISTENT_H */
@@ -0,0 +1,247 @@
+/*
+ *  scan/mpi_pipeline.h - Pipelined scatter and prefix scan over MPI.
+ */
+
+/*---------------------------------------------------------
+ *  Pipelined Scatter + Scan
+ *
+ *  scatter_inclusive_scan and scatter_exclusive_scan distribute the
+ *  sequence held by rank 0 (like MPI_Scatterv) and scan it (like the MPI
+ *  backend of scan/mpi.h) in a single call, overlapping the two:
+ *
+ *  1. Rank 0 posts an MPI_Isend for every sub-chunk of every slice, the
+ *     first sub-chunk of all slices first; every other process posts an
+ *     MPI_Irecv for every sub-chunk of its slice.
+ *  2. Every process scans its sub-chunks in order as they land, carrying
+ *     the total of the previous ones.  Rank 0 copies and scans its own
+ *     slice meanwhile, testing its sends so that they progress.
+ *  3. The last sub-chunk is reduced first: the slice total is then known
+ *     and the offset exchange starts (MPI_Iexscan) while the last
+ *     sub-chunk is scanned.
+ *  4. The total is broadcast (MPI_Ibcast) while the offset is added back.
+ *
+ *  The end-to-end time thus approaches max(transfer, scan) rather than
+ *  their sum.  Only the exscan exchange has a nonblocking form (MPI-3);
+ *  linear and recursive_doubling exchange after the last sub-chunk.
+ *
+ *  Values are shipped as raw bytes, so In must be trivially copyable.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_MPI_PIPELINE_H
+#define SCAN_MPI_PIPELINE_H
+
+#include <mpi.h>
+#include <limits.h>
+#include <vector>
+#include <algorithm>
+#include "mpi.h"
+
+namespace scan {
+
+namespace detail {
+
+const int scatter_tag = 627;
+const long pipeline_chunk = 1L << 16;  /* default elements per sub-chunk */
+
+/*==============================================================
+ * reduce_block (fold of [first,last) into acc)
+ *==============================================================*/
+template <typename InIt, typename Op, typename T>
+inline T reduce_block(InIt first, InIt last, Op op, T acc) {
+  for(; first != last; ++first) acc = op(acc, T(*first));
+  return acc;
+}
+
+/*==============================================================
+ * exscan_begin / exscan_end (exchange_exscan split around an
+ *   MPI_Iexscan; op must stay alive until exscan_end)
+ *==============================================================*/
+template <typename T, typename Op>
+struct pending_exscan {
+  MPI_Request request;
+  int rank;
+  carry<T> local;
+  carry<T> offset;
+};
+
+template <typename T, typename Op>
+void exscan_begin(MPI_Comm comm, pending_exscan<T, Op>& x, const Op& op) {
+  exscan_op<T, Op>::current = &op;
+
+  MPI_Comm_rank(comm, &x.rank);
+  MPI_Iexscan(&x.local, &x.offset, 1, exscan_op<T, Op>::datatype(), exscan_op<T, Op>::mpi_op(),
+              comm, &x.request);
+}
+
+template <typename T, typename Op>
+carry<T> exscan_end(pending_exscan<T, Op>& x) {
+  MPI_Wait(&x.request, MPI_STATUS_IGNORE);
+  exscan_op<T, Op>::current = NULL;
+
+  /* MPI_Iexscan leaves the result of rank 0 undefined */
+  if( x.rank == 0 ) x.offset.valid = 0;
+  return x.offset;
+}
+
+/*==============================================================
+ * mpi_scatter_scan (scatter from rank 0 and inclusive or
+ *                   exclusive scan, pipelined by sub-chunks)
+ *==============================================================*/
+template <bool Exclusive, typename In, typename OutIt, typename Op, typename T>
+OutIt mpi_scatter_scan(const mpi& policy, const In* sendbuf, const int* counts, const int* displs,
+                       In* slice, long n, long chunk, OutIt out, Op op, T init, T* total) {
+  int my_id, nprocs;
+  MPI_Comm_rank(policy.comm, &my_id);
+  MPI_Comm_size(policy.comm, &nprocs);
+
+  /* MPI counts are ints: a sub-chunk is at most INT_MAX bytes */
+  if( chunk <= 0 ) chunk = pipeline_chunk;
+  chunk = std::min(chunk, (long)(INT_MAX / sizeof(In)));
+  const long nchunks = (n + chunk - 1) / chunk;
+
+  /*---------------------------------------------------------
+   * 1. Post the transfers of all sub-chunks
+   *---------------------------------------------------------*/
+  std::vector<MPI_Request> requests;
+  if( my_id == 0 ) {
+    long max_count = 0;
+    for(int i=1;i<nprocs;++i) max_count = std::max(max_count, (long)counts[i]);
+    for(long c=0;c<max_count;c+=chunk) {
+      for(int i=1;i<nprocs;++i) {
+        if( c >= counts[i] ) continue;
+        long m = std::min(chunk, counts[i] - c);
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(const_cast<In*>(sendbuf + displs[i] + c), m * sizeof(In), MPI_BYTE, i,
+                  scatter_tag, policy.comm, &requests.back());
+      }
+    }
+  }
+  else {
+    requests.resize(nchunks);
+    for(long j=0;j<nchunks;++j) {
+      long m = std::min(chunk, n - j*chunk);
+      MPI_Irecv(slice + j*chunk, m * sizeof(In), MPI_BYTE, 0, scatter_tag, policy.comm,
+                &requests[j]);
+    }
+  }
+
+  /*---------------------------------------------------------
+   * 2-3. Scan the sub-chunks as they land; start the exchange
+   *      before the last one
+   *---------------------------------------------------------*/
+  const bool overlap = nprocs > 1 && policy.exchange == mpi::exscan;
+  carry<T> local;
+  local.valid = (n > 0) || (my_id == 0);
+  local.value = init;
+  T acc = init;
+
+  /* x.local is the send buffer of the MPI_Iexscan: left alone until exscan_end */
+  pending_exscan<T, Op> x;
+
+  for(long j=0;j<nchunks;++j) {
+    long c0 = j*chunk, c1 = std::min(n, c0 + chunk);
+    if( my_id == 0 ) {
+      phase_timer timer(phase_scatter);
+      std::copy(sendbuf + displs[0] + c0, sendbuf + displs[0] + c1, slice + c0);
+      int done;
+      MPI_Testall(requests.size(), requests.data(), &done, MPI_STATUSES_IGNORE);
+    }
+    else {
+      {
+        phase_timer timer(phase_scatter);
+        MPI_Wait(&requests[j], MPI_STATUS_IGNORE);
+      }
+      if( j == 0 ) {
+        /* an exclusive scan leaves out[0] of the other ranks for later */
+        acc = T(slice[0]);
+        if( !Exclusive ) out[0] = acc;
+        c0 = 1;
+      }
+    }
+
+    if( j == nchunks-1 && overlap ) {
+      phase_timer timer(phase_reduce);
+      x.local = local;
+      x.local.value = reduce_block(slice + c0, slice + c1, op, acc);
+      exscan_begin(policy.comm, x, op);
+    }
+    phase_timer timer(phase_local_scan);
+    acc = scan_block<Exclusive>(slice + c0, slice + c1, out + c0, op, acc);
+  }
+  if( n > 0 || my_id == 0 ) local.value = acc;
+  if( overlap && nchunks == 0 ) {
+    x.local = local;
+    exscan_begin(policy.comm, x, op);
+  }
+
+  if( my_id == 0 ) {
+    phase_timer timer(phase_scatter);
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+  }
+
+  if( nprocs == 1 ) {
+    if( total ) *total = local.value;
+    return out + n;
+  }
+
+  /* Get the total of the preceding processes */
+  carry<T> offset;
+  {
+    phase_timer timer(phase_exchange);
+    offset = overlap ? exscan_end(x) : exchange_offset(policy, my_id, nprocs, local, op);
+  }
+
+  /*---------------------------------------------------------
+   * 4. Broadcast the total while the offset is added back
+   *---------------------------------------------------------*/
+  carry<T> sum = combine(offset, local, op);
+  MPI_Request bcast = MPI_REQUEST_NULL;
+  if( total ) MPI_Ibcast(&sum, sizeof(carry<T>), MPI_BYTE, nprocs-1, policy.comm, &bcast);
+
+  if( my_id > 0 && n > 0 ) {
+    phase_timer timer(phase_add_back);
+    if( Exclusive ) {
+      out[0] = offset.value;
+      add_offset(out+1, out+n, op, offset.value);
+    }
+    else {
+      add_offset(out, out+n, op, offset.value);
+    }
+  }
+
+  if( total ) {
+    phase_timer timer(phase_total);
+    MPI_Wait(&bcast, MPI_STATUS_IGNORE);
+    *total = sum.value;
+  }
+  return out + n;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * scatter_inclusive_scan / scatter_exclusive_scan (collective over
+ *   policy.comm; sendbuf, counts and displs are significant on
+ *   rank 0 only, as for MPI_Scatterv; every process receives its
+ *   n elements in slice and their prefix scan in out, chunk
+ *   elements at a time (0: default))
+ *==============================================================*/
+template <typename In, typename OutIt, typename Op, typename T>
+OutIt scatter_inclusive_scan(const mpi& policy, const In* sendbuf, const int* counts,
+                             const int* displs, In* slice, long n, long chunk, OutIt out,
+                             Op op, T init, T* total = NULL) {
+  return detail::mpi_scatter_scan<false>(policy, sendbuf, counts, displs, slice, n, chunk,
+                                         out, op, init, total);
+}
+
+template <typename In, typename OutIt, typename Op, typename T>
+OutIt scatter_exclusive_scan(const mpi& policy, const In* sendbuf, const int* counts,
+                             const int* displs, In* slice, long n, long chunk, OutIt out,
+                             Op op, T init, T* total = NULL) {
+  return detail::mpi_scatter_scan<true>(policy, sendbuf, counts, displs, slice, n, chunk,
+                                        out, op, init, total);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_MPI_PIPELINE_H */
@@ -0,0 +1,147 @@
+/*
+ *  scan/numa.h - NUMA-aware buffers and thread pinning for the OpenMP scan.
+ */
+
+/*---------------------------------------------------------
+ *  NUMA Placement (Linux)
+ *
+ *  Linux places a page on the node of the thread that first writes it.
+ *  std::vector::resize zero-fills from the calling thread, so a vector
+ *  allocated by the master lands entirely on its socket and the threads of
+ *  the other socket stream across the interconnect.
+ *
+ *  - pin_threads binds thread i of a team to the i-th allowed cpu, so the
+ *    same thread (and node) owns the same block from one region to the next
+ *  - numa_buffer leaves its memory untouched on allocation and lets every
+ *    thread construct its own block (block_range, as the scan partitions it)
+ *  - node_bytes reports on which nodes the pages of a buffer are
+ *
+ *  Pin the team before allocating, with the thread count used afterwards.
+ *  The static algorithms (scan_then_propagate, reduce_then_scan) then touch
+ *  only local pages; the dynamic ones reach across nodes for some chunks.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_NUMA_H
+#define SCAN_NUMA_H
+
+#include <omp.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <new>
+#include <vector>
+#include "partition.h"
+
+namespace scan {
+
+/*==============================================================
+ * pin_threads (binds thread i of a team of nthreads to the
+ *              i-th cpu allowed to the process; returns the
+ *              number of threads actually pinned)
+ *==============================================================*/
+inline int pin_threads(int nthreads) {
+  cpu_set_t allowed;
+  if( sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ) return 0;
+
+  std::vector<int> cpus;
+  for(int cpu=0;cpu<CPU_SETSIZE;++cpu)
+    if( CPU_ISSET(cpu, &allowed) ) cpus.push_back(cpu);
+  if( cpus.empty() ) return 0;
+
+  int pinned = 0;
+#pragma omp parallel num_threads(nthreads) reduction(+:pinned)
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &set);
+    if( sched_setaffinity(0, sizeof(set), &set) == 0 ) pinned++;
+  }
+  return pinned;
+}
+
+/*==============================================================
+ * node_bytes (bytes of [addr, addr+bytes) resident on every
+ *             node, indexed by node; pages not yet touched are
+ *             not counted; empty if the kernel cannot tell)
+ *==============================================================*/
+inline std::vector<long> node_bytes(const void* addr, size_t bytes) {
+  std::vector<long> result;
+#ifdef SYS_move_pages
+  const long page = sysconf(_SC_PAGESIZE);
+  const size_t batch = 4096;
+
+  char* p = (char*)((size_t)addr & ~(size_t)(page - 1));
+  char* end = (char*)addr + bytes;
+
+  std::vector<void*> pages;
+  std::vector<int> status;
+  while( p < end ) {
+    pages.clear();
+    for(; p < end && pages.size() < batch; p += page) pages.push_back(p);
+    status.assign(pages.size(), -1);
+
+    /* move_pages with no target nodes only queries where the pages are */
+    if( syscall(SYS_move_pages, 0, pages.size(), &pages[0], NULL, &status[0], 0) != 0 )
+      return std::vector<long>();
+
+    for(size_t i=0;i<status.size();++i) {
+      if( status[i] < 0 ) continue;
+      if( status[i] >= (int)result.size() ) result.resize(status[i] + 1, 0);
+      result[status[i]] += page;
+    }
+  }
+#endif
+  return result;
+}
+
+/*==============================================================
+ * numa_buffer (fixed-size array whose pages are first touched
+ *              by the threads that own them)
+ *==============================================================*/
+template <typename T>
+class numa_buffer {
+ public:
+  /* Element i is constructed by the thread owning it under
+     block_range(n, nthreads, .) */
+  numa_buffer(long n, int nthreads) : n_(n), data_(NULL) {
+    void* mem = NULL;
+    long page = sysconf(_SC_PAGESIZE);
+    if( posix_memalign(&mem, page, (n > 0 ? n : 1) * sizeof(T)) != 0 )
+      throw std::bad_alloc();
+    data_ = static_cast<T*>(mem);
+
+#pragma omp parallel num_threads(nthreads)
+    {
+      long pos0, pos1;
+      block_range(n_, omp_get_num_threads(), omp_get_thread_num(), &pos0, &pos1);
+      for(long i=pos0;i<pos1;++i) new (&data_[i]) T();
+    }
+  }
+
+  ~numa_buffer() {
+    for(long i=0;i<n_;++i) data_[i].~T();
+    free(data_);
+  }
+
+  long size() const { return n_; }
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  T* begin() { return data_; }
+  T* end() { return data_ + n_; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + n_; }
+  T& operator[](long i) { return data_[i]; }
+  const T& operator[](long i) const { return data_[i]; }
+
+ private:
+  numa_buffer(const numa_buffer&);
+  numa_buffer& operator=(const numa_buffer&);
+
+  long n_;
+  T* data_;
+};
+
+} /* namespace scan */
+
+#endif /* SCAN_NUMA_H */
@@ -0,0 +1,621 @@
+/*
+ *  scan/openmp.h - OpenMP backend of the prefix scan library.
+ */
+
+/*---------------------------------------------------------
+ *  Parallel Prefix Scan (OpenMP)
+ *
+ *  A single parallel region per scan; the team synchronizes with one
+ *  barrier instead of being forked and joined twice.
+ *
+ *  scan_then_propagate (reads and writes the sequence twice):
+ *  1. Each thread computes the prefix scan of its block
+ *     and publishes the block total in its own cache line
+ *  2. Barrier
+ *  3. Each thread folds the totals of the preceding blocks (in-team offset)
+ *  4. Each thread adds the offset back to its block
+ *
+ *  reduce_then_scan (reads the input twice, writes the output once):
+ *  1. Each thread reduces its block and publishes the block total
+ *  2. Barrier
+ *  3. Each thread folds the totals of the preceding blocks (in-team offset)
+ *  4. Each thread computes the prefix scan of its block seeded with the offset
+ *
+ *  reduce_then_scan saves the write-back pass, which pays off once the
+ *  sequence no longer fits in the last level cache.
+ *
+ *  decoupled_lookback (single pass, no barrier):
+ *  1. Each thread claims the next tile from an atomic counter
+ *  2. It reduces the tile and publishes the aggregate (status flag)
+ *  3. It looks back over the preceding tiles, folding aggregates until it
+ *     meets a tile whose inclusive prefix is published
+ *  4. It publishes its own inclusive prefix and scans the tile seeded with
+ *     the exclusive one; the tile is still in cache for this second read
+ *  Tiles are handed out dynamically, so a slow core delays only the tiles
+ *  it owns instead of a whole 1/nthreads block.
+ *
+ *  dynamic_chunks (reduce_then_scan over many more chunks than threads):
+ *  1. The chunks are reduced under schedule(dynamic); chunk 0, and a chunk
+ *     following one its thread has just scanned, are scanned right away
+ *  2. One thread folds the chunk totals into chunk offsets (O(nchunks))
+ *  3. The remaining chunks are scanned seeded with their offsets, again
+ *     under schedule(dynamic)
+ *  A core slowed by OS noise or a busy hyperthread sibling takes fewer
+ *  chunks; the others pick up the rest instead of waiting at the barrier.
+ *
+ *  Exclusive scans run the same algorithms with the exclusive block scan;
+ *  the total comes from the published block, tile or chunk totals.
+ *
+ *  Segmented scans (scan/segmented.h) always use one block per thread:
+ *  every thread scans its block, and after the barrier only the elements
+ *  before its first segment head take the carry of the preceding blocks.
+ *
+ *  Reproducible sums (scan/reproducible.h) also use one block per thread,
+ *  like reduce_then_scan, after a first pass for the grid of the bins.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_OPENMP_H
+#define SCAN_OPENMP_H
+
+#include <omp.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <new>
+#include <iterator>
+#include <atomic>
+#include <algorithm>
+#include <string.h>
+#include "serial.h"
+#include "partition.h"
+#include "segmented.h"
+#include "reproducible.h"
+
+namespace scan {
+
+/* Policy selecting the OpenMP backend; nthreads <= 0 uses omp_get_max_threads() */
+struct openmp {
+  enum algorithm_t { scan_then_propagate, reduce_then_scan, decoupled_lookback, dynamic_chunks };
+
+  int nthreads;
+  algorithm_t algorithm;
+  long tile_size;  /* elements per tile of decoupled_lookback (<= 0 picks ~128KB tiles)
+                      or per chunk of dynamic_chunks (<= 0 picks 16 chunks per thread) */
+  store_mode stores;
+
+  explicit openmp(int nthreads = 0, algorithm_t algorithm = scan_then_propagate,
+                  long tile_size = 0, store_mode stores = store_automatic)
+    : nthreads(nthreads), algorithm(algorithm), tile_size(tile_size), stores(stores) {
+  }
+
+  int num_threads() const {
+    return nthreads > 0 ? nthreads : omp_get_max_threads();
+  }
+};
+
+/*==============================================================
+ * algorithm_name / parse_algorithm (names used on command lines)
+ *==============================================================*/
+inline const char* algorithm_name(openmp::algorithm_t algorithm) {
+  switch( algorithm ) {
+  case openmp::reduce_then_scan:   return "reduce_then_scan";
+  case openmp::decoupled_lookback: return "decoupled_lookback";
+  case openmp::dynamic_chunks:     return "dynamic_chunks";
+  default:                         return "scan_then_propagate";
+  }
+}
+
+inline bool parse_algorithm(const char* name, openmp::algorithm_t* algorithm) {
+  if( strcmp(name, "scan_then_propagate") == 0 ) *algorithm = openmp::scan_then_propagate;
+  else if( strcmp(name, "reduce_then_scan") == 0 ) *algorithm = openmp::reduce_then_scan;
+  else if( strcmp(name, "decoupled_lookback") == 0 ) *algorithm = openmp::decoupled_lookback;
+  else if( strcmp(name, "dynamic_chunks") == 0 ) *algorithm = openmp::dynamic_chunks;
+  else return false;
+  return true;
+}
+
+namespace detail {
+
+const size_t cache_line = 64;
+
+/* Chunks per thread of dynamic_chunks, and the smallest chunk worth scheduling */
+const long chunks_per_thread = 16;
+const long min_chunk_size = 1024;
+
+/*==============================================================
+ * padded_slots (one value per thread, each in its own cache line,
+ *               so that publishing a block total does not
+ *               invalidate the line holding another thread's slot)
+ *==============================================================*/
+template <typename T>
+class padded_slots {
+ public:
+  explicit padded_slots(long n) : n_(n), slots_(NULL) {
+    void* mem = NULL;
+    if( posix_memalign(&mem, cache_line, n * sizeof(slot)) != 0 )
+      throw std::bad_alloc();
+    slots_ = static_cast<slot*>(mem);
+    for(long i=0;i<n_;++i) new (&slots_[i]) slot();
+  }
+
+  ~padded_slots() {
+    for(long i=0;i<n_;++i) slots_[i].~slot();
+    free(slots_);
+  }
+
+  T& operator[](long i) { return slots_[i].value; }
+  const T& operator[](long i) const { return slots_[i].value; }
+
+ private:
+  struct alignas(cache_line) slot {
+    T value;
+  };
+
+  padded_slots(const padded_slots&);
+  padded_slots& operator=(const padded_slots&);
+
+  long n_;
+  slot* slots_;
+};
+
+/*==============================================================
+ * reduce_serial (folds [first,last) into acc)
+ *==============================================================*/
+template <typename InIt, typename Op, typename T>
+inline T reduce_serial(InIt first, InIt last, Op op, T acc) {
+  for(; first != last; ++first) acc = op(acc, *first);
+  return acc;
+}
+
+/*==============================================================
+ * block_offset (folds the totals of the blocks preceding tid;
+ *               block 0 already includes init)
+ *==============================================================*/
+template <typename Op, typename T>
+inline T block_offset(const padded_slots<T>& partial_sums, int tid, Op op) {
+  T ps = partial_sums[0];
+  for(int i=1;i<tid;++i) ps = op(ps, partial_sums[i]);
+  return ps;
+}
+
+/*==============================================================
+ * omp_scan_then_propagate (called by every thread of the team)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename OutIt, typename Op, typename T, typename Size>
+void omp_scan_then_propagate(InIt first, OutIt out, Size pos0, Size pos1, Op op, T init,
+                             bool stream, padded_slots<T>& partial_sums) {
+  int tid = omp_get_thread_num();
+
+  /* Compute the local prefix scan, the first block also folds in init
+     (only the first block is final, the others are read again below;
+     an exclusive scan leaves out[pos0] to the second pass) */
+  if( pos0 < pos1 ) {
+    phase_timer timer(phase_local_scan, tid);
+    if( tid == 0 ) {
+      partial_sums[tid] = scan_block<Exclusive>(first+pos0, first+pos1, out+pos0, op, init,
+                                                stream);
+    }
+    else {
+      T acc = first[pos0];
+      if( !Exclusive ) out[pos0] = acc;
+      partial_sums[tid] = scan_block<Exclusive>(first+pos0+1, first+pos1, out+pos0+1, op, acc);
+    }
+  }
+
+  T ps = T();
+  {
+    phase_timer timer(phase_exchange, tid);
+#pragma omp barrier
+    if( tid > 0 && pos0 < pos1 ) ps = block_offset(partial_sums, tid, op);
+  }
+
+  /* add the offset back to the prefix scan */
+  if( tid > 0 && pos0 < pos1 ) {
+    phase_timer timer(phase_add_back, tid);
+    if( Exclusive ) {
+      out[pos0] = ps;
+      add_offset(out+pos0+1, out+pos1, op, ps, stream);
+    }
+    else {
+      add_offset(out+pos0, out+pos1, op, ps, stream);
+    }
+  }
+}
+
+/*==============================================================
+ * omp_reduce_then_scan (called by every thread of the team)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename OutIt, typename Op, typename T, typename Size>
+void omp_reduce_then_scan(InIt first, OutIt out, Size pos0, Size pos1, Op op, T init,
+                          bool stream, padded_slots<T>& partial_sums) {
+  int tid = omp_get_thread_num();
+
+  /* Reduce the local block; the first block needs no offset and is scanned right away */
+  if( pos0 < pos1 ) {
+    phase_timer timer(tid == 0 ? phase_local_scan : phase_reduce, tid);
+    if( tid == 0 )
+      partial_sums[tid] = scan_block<Exclusive>(first+pos0, first+pos1, out+pos0, op, init, stream);
+    else
+      partial_sums[tid] = reduce_serial(first+pos0+1, first+pos1, op, T(first[pos0]));
+  }
+
+  T ps = T();
+  {
+    phase_timer timer(phase_exchange, tid);
+#pragma omp barrier
+    if( tid > 0 && pos0 < pos1 ) ps = block_offset(partial_sums, tid, op);
+  }
+
+  /* Compute the local prefix scan seeded with the offset */
+  if( tid > 0 && pos0 < pos1 ) {
+    phase_timer timer(phase_local_scan, tid);
+    scan_block<Exclusive>(first+pos0, first+pos1, out+pos0, op, ps, stream);
+  }
+}
+
+/* Status of a tile of decoupled_lookback */
+enum { tile_invalid = 0, tile_aggregate = 1, tile_prefix = 2 };
+
+/* Published state of a tile; fields are written before the release of status */
+template <typename T>
+struct tile_state {
+  std::atomic<int> status;
+  T aggregate;  /* total of the tile alone */
+  T prefix;     /* inclusive prefix up to the end of the tile */
+
+  tile_state() : status(tile_invalid) {
+  }
+};
+
+/*==============================================================
+ * wait_tile (spins until the tile has published something)
+ *==============================================================*/
+template <typename T>
+inline int wait_tile(const tile_state<T>& state) {
+  int status;
+  for(int spins=0; (status = state.status.load(std::memory_order_acquire)) == tile_invalid; ++spins) {
+    /* the owner may be descheduled, give up the core now and then */
+    if( (spins & 63) == 63 ) sched_yield();
+  }
+  return status;
+}
+
+/*==============================================================
+ * omp_decoupled_lookback (called by every thread of the team)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename OutIt, typename Op, typename T, typename Size>
+void omp_decoupled_lookback(InIt first, OutIt out, Size numints, Size tile_size, Op op, T init,
+                            bool stream, padded_slots<tile_state<T> >& tiles,
+                            std::atomic<Size>& next_tile) {
+  const Size ntiles = (numints + tile_size - 1) / tile_size;
+  const int tid = omp_get_thread_num();
+
+  for(;;) {
+    Size tile = next_tile.fetch_add(1, std::memory_order_relaxed);
+    if( tile >= ntiles ) break;
+
+    Size pos0 = tile * tile_size;
+    Size pos1 = std::min(pos0 + tile_size, numints);
+    tile_state<T>& state = tiles[tile];
+
+    /* The first tile, or a tile whose predecessor is done, is scanned in one pass */
+    if( tile == 0 || tiles[tile-1].status.load(std::memory_order_acquire) == tile_prefix ) {
+      phase_timer timer(phase_local_scan, tid);
+      T ps = (tile == 0) ? init : tiles[tile-1].prefix;
+      state.prefix = scan_block<Exclusive>(first+pos0, first+pos1, out+pos0, op, ps, stream);
+      state.status.store(tile_prefix, std::memory_order_release);
+      continue;
+    }
+
+    /* Publish the aggregate so that later tiles can look past this one */
+    T aggregate;
+    {
+      phase_timer timer(phase_reduce, tid);
+      aggregate = reduce_serial(first+pos0+1, first+pos1, op, T(first[pos0]));
+    }
+    state.aggregate = aggregate;
+    state.status.store(tile_aggregate, std::memory_order_release);
+
+    /* Look back, folding aggregates until an inclusive prefix is found */
+    T ps = T();
+    bool have_ps = false;
+    {
+      phase_timer timer(phase_exchange, tid);
+      for(Size j=tile-1;;--j) {
+        if( wait_tile(tiles[j]) == tile_prefix ) {
+          ps = have_ps ? op(tiles[j].prefix, ps) : tiles[j].prefix;
+          break;
+        }
+        ps = have_ps ? op(tiles[j].aggregate, ps) : tiles[j].aggregate;
+        have_ps = true;
+      }
+    }
+
+    state.prefix = op(ps, aggregate);
+    state.status.store(tile_prefix, std::memory_order_release);
+
+    phase_timer timer(phase_local_scan, tid);
+    scan_block<Exclusive>(first+pos0, first+pos1, out+pos0, op, ps, stream);
+  }
+}
+
+/* Total of a chunk of dynamic_chunks, or its inclusive prefix once scanned */
+template <typename T>
+struct chunk_state {
+  T sum;
+  bool scanned;
+
+  chunk_state() : sum(), scanned(false) {
+  }
+};
+
+/*==============================================================
+ * omp_dynamic_chunks (called by every thread of the team)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename OutIt, typename Op, typename T, typename Size>
+void omp_dynamic_chunks(InIt first, OutIt out, Size numints, Size chunk_size, Op op, T init,
+                        bool stream, padded_slots<chunk_state<T> >& chunks) {
+  const Size nchunks = (numints + chunk_size - 1) / chunk_size;
+  Size last_scanned = -1;  /* last chunk this thread scanned in the first pass */
+  const int tid = omp_get_thread_num();
+
+  /* Reduce every chunk; chunk 0, and a chunk right after one this thread has
+     just scanned, have a known offset and are scanned right away */
+#pragma omp for schedule(dynamic, 1) nowait
+  for(Size chunk=0; chunk<nchunks; ++chunk) {
+    Size pos0 = chunk * chunk_size;
+    Size pos1 = std::min(pos0 + chunk_size, numints);
+    bool seeded = chunk == 0 || chunk == last_scanned + 1;
+    phase_timer timer(seeded ? phase_local_scan : phase_reduce, tid);
+    if( seeded ) {
+      T ps = (chunk == 0) ? init : chunks[chunk-1].sum;
+      chunks[chunk].sum = scan_block<Exclusive>(first+pos0, first+pos1, out+pos0, op, ps, stream);
+      chunks[chunk].scanned = true;
+      last_scanned = chunk;
+    }
+    else {
+      chunks[chunk].sum = reduce_serial(first+pos0+1, first+pos1, op, T(first[pos0]));
+    }
+  }
+
+  /* The scanned chunks are 0..k; fold the totals of the others into prefixes */
+  {
+    phase_timer timer(phase_exchange, tid);
+#pragma omp barrier
+#pragma omp single
+    for(Size chunk=1; chunk<nchunks; ++chunk)
+      if( !chunks[chunk].scanned ) chunks[chunk].sum = op(chunks[chunk-1].sum, chunks[chunk].sum);
+  }
+
+  /* Compute the prefix scan of every other chunk seeded with its offset */
+#pragma omp for schedule(dynamic, 1)
+  for(Size chunk=1; chunk<nchunks; ++chunk) {
+    if( chunks[chunk].scanned ) continue;
+    Size pos0 = chunk * chunk_size;
+    Size pos1 = std::min(pos0 + chunk_size, numints);
+    phase_timer timer(phase_local_scan, tid);
+    scan_block<Exclusive>(first+pos0, first+pos1, out+pos0, op, T(chunks[chunk-1].sum), stream);
+  }
+}
+
+/*==============================================================
+ * omp_segmented_scan (segmented scan with one block per thread)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+OutIt omp_segmented_scan(const openmp& policy, InIt first, InIt last, FlagIt flags, OutIt out,
+                         Op op, T init) {
+  typedef typename std::iterator_traits<InIt>::difference_type diff_t;
+
+  const diff_t numints = last - first;
+  const int numprocs = policy.num_threads();
+
+  if( numints == 0 ) return out;
+
+  /* carries[tid] holds the segment carry of block tid (block 0 starts a segment) */
+  padded_slots<segment<T> > carries(numprocs);
+
+#pragma omp parallel num_threads(numprocs)
+  {
+    int tid = omp_get_thread_num();
+    diff_t pos0, pos1;
+    block_range(numints, omp_get_num_threads(), tid, &pos0, &pos1);
+
+    segment<T> carry;
+    diff_t first_head = segmented_block<Exclusive>(first, flags, out, pos0, pos1, op, init,
+                                                   tid == 0, &carry);
+    carries[tid] = carry;
+
+#pragma omp barrier
+
+    /* only the elements before the first head continue a preceding segment */
+    if( tid > 0 && first_head > pos0 ) {
+      segment<T> offset = block_offset(carries, tid, segment_op<Op>(op));
+      segmented_fixup<Exclusive>(out, pos0, first_head, op, offset.value);
+    }
+  }
+
+  return out + numints;
+}
+
+/*==============================================================
+ * omp_reproducible_scan (reproducible prefix sums with one block
+ *                        per thread, or only the total unless
+ *                        write; returns the bins of the total)
+ *==============================================================*/
+template <typename InIt, typename OutIt>
+bins omp_reproducible_scan(const openmp& policy, InIt first, InIt last, OutIt out, bool write,
+                           bin_grid* grid) {
+  typedef typename std::iterator_traits<InIt>::difference_type diff_t;
+
+  const diff_t numints = last - first;
+  const int numprocs = policy.num_threads();
+
+  padded_slots<double> max_abs(numprocs);
+  padded_slots<bins> partial_sums(numprocs);
+  int nthreads = 1;
+
+#pragma omp parallel num_threads(numprocs)
+  {
+    int tid = omp_get_thread_num();
+    int team = omp_get_num_threads();
+    diff_t pos0, pos1;
+    block_range(numints, team, tid, &pos0, &pos1);
+    if( tid == 0 ) nthreads = team;
+
+    /* 1. the grid depends on the largest magnitude of the whole sequence */
+    max_abs[tid] = max_abs_serial(first+pos0, first+pos1, 0.0);
+
+#pragma omp barrier
+
+    double m = 0.0;
+    for(int i=0;i<team;++i) m = std::max(m, max_abs[i]);
+    bin_grid g = make_bin_grid(m, numints);
+    if( tid == 0 ) *grid = g;
+
+    /* 2. exact sums of the bins of every block */
+    partial_sums[tid] = reduce_bins(first+pos0, first+pos1, g);
+
+    /* 3. prefix sums seeded with the bins of the preceding blocks */
+    if( write ) {
+#pragma omp barrier
+      bins acc = { 0, 0 };
+      if( tid > 0 ) acc = block_offset(partial_sums, tid, bins_plus());
+      reproducible_block(first+pos0, first+pos1, out+pos0, acc, g);
+    }
+  }
+
+  return block_offset(partial_sums, nthreads, bins_plus());
+}
+
+/*==============================================================
+ * omp_scan (inclusive or exclusive scan with the algorithm of
+ *           the policy; the total is stored in *total if not NULL)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename OutIt, typename Op, typename T>
+OutIt omp_scan(const openmp& policy, InIt first, InIt last, OutIt out, Op op, T init, T* total) {
+  typedef typename std::iterator_traits<InIt>::difference_type diff_t;
+
+  const diff_t numints = last - first;
+  const int numprocs = policy.num_threads();
+
+  if( numints == 0 ) {
+    if( total ) *total = init;
+    return out;
+  }
+
+  /* Outputs much larger than the cache bypass it */
+  const bool stream = use_streaming<T>(policy.stores, numints);
+
+  if( policy.algorithm == openmp::decoupled_lookback ) {
+    diff_t tile_size = policy.tile_size;
+    if( tile_size <= 0 ) tile_size = std::max<diff_t>(1024, (1 << 17) / sizeof(T));
+
+    const diff_t ntiles = (numints + tile_size - 1) / tile_size;
+    padded_slots<tile_state<T> > tiles(ntiles);
+    std::atomic<diff_t> next_tile(0);
+
+#pragma omp parallel num_threads(numprocs)
+    omp_decoupled_lookback<Exclusive>(first, out, numints, tile_size, op, init, stream, tiles,
+                                      next_tile);
+
+    if( total ) *total = tiles[ntiles-1].prefix;
+    return out + numints;
+  }
+
+  if( policy.algorithm == openmp::dynamic_chunks ) {
+    diff_t chunk_size = policy.tile_size;
+    if( chunk_size <= 0 ) {
+      diff_t nchunks = chunks_per_thread * numprocs;
+      chunk_size = std::max<diff_t>(min_chunk_size, (numints + nchunks - 1) / nchunks);
+    }
+
+    const diff_t nchunks = (numints + chunk_size - 1) / chunk_size;
+    padded_slots<chunk_state<T> > chunks(nchunks);
+
+#pragma omp parallel num_threads(numprocs)
+    omp_dynamic_chunks<Exclusive>(first, out, numints, chunk_size, op, init, stream, chunks);
+
+    if( total ) *total = chunks[nchunks-1].sum;
+    return out + numints;
+  }
+
+  /* partial_sums[tid] holds the total of block tid (block 0 includes init) */
+  padded_slots<T> partial_sums(numprocs);
+  int nthreads = 1;
+
+#pragma omp parallel num_threads(numprocs)
+  {
+    diff_t pos0, pos1;
+    block_range(numints, omp_get_num_threads(), omp_get_thread_num(), &pos0, &pos1);
+    if( omp_get_thread_num() == 0 ) nthreads = omp_get_num_threads();
+
+    if( policy.algorithm == openmp::reduce_then_scan )
+      omp_reduce_then_scan<Exclusive>(first, out, pos0, pos1, op, init, stream, partial_sums);
+    else
+      omp_scan_then_propagate<Exclusive>(first, out, pos0, pos1, op, init, stream, partial_sums);
+  }
+
+  /* the blocks past the end of a short sequence are empty */
+  if( total ) *total = block_offset(partial_sums, (int)std::min<diff_t>(nthreads, numints), op);
+  return out + numints;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * inclusive_scan / exclusive_scan (OpenMP backend; the total is
+ *                                  stored in *total if not NULL)
+ *==============================================================*/
+template <typename InIt, typename OutIt, typename Op, typename T>
+OutIt inclusive_scan(const openmp& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                     T* total = NULL) {
+  return detail::omp_scan<false>(policy, first, last, out, op, init, total);
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+OutIt exclusive_scan(const openmp& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                     T* total = NULL) {
+  return detail::omp_scan<true>(policy, first, last, out, op, init, total);
+}
+
+/*==============================================================
+ * reproducible_inclusive_scan / reproducible_reduce (OpenMP
+ *   backend; the same bits for any number of threads)
+ *==============================================================*/
+template <typename InIt, typename OutIt>
+OutIt reproducible_inclusive_scan(const openmp& policy, InIt first, InIt last, OutIt out,
+                                  typename std::iterator_traits<InIt>::value_type* total = NULL) {
+  typedef typename std::iterator_traits<InIt>::value_type T;
+  bin_grid g;
+  bins sum = detail::omp_reproducible_scan(policy, first, last, out, true, &g);
+  if( total ) *total = from_bins<T>(sum, g);
+  return out + (last - first);
+}
+
+template <typename InIt>
+typename std::iterator_traits<InIt>::value_type
+reproducible_reduce(const openmp& policy, InIt first, InIt last) {
+  typedef typename std::iterator_traits<InIt>::value_type T;
+  bin_grid g;
+  bins sum = detail::omp_reproducible_scan(policy, first, last, (T*)NULL, false, &g);
+  return from_bins<T>(sum, g);
+}
+
+/*==============================================================
+ * segmented_inclusive_scan / segmented_exclusive_scan
+ *   (OpenMP backend, segments given by flags)
+ *==============================================================*/
+template <typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+OutIt segmented_inclusive_scan(const openmp& policy, InIt first, InIt last, FlagIt flags,
+                               OutIt out, Op op, T init) {
+  return detail::omp_segmented_scan<false>(policy, first, last, flags, out, op, init);
+}
+
+template <typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+OutIt segmented_exclusive_scan(const openmp& policy, InIt first, InIt last, FlagIt flags,
+                               OutIt out, Op op, T init) {
+  return detail::omp_segmented_scan<true>(policy, first, last, flags, out, op, init);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_OPENMP_H */
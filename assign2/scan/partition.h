@@ -0,0 +1,26 @@
+/*
+ *  scan/partition.h - Block partitioning of a sequence among workers.
+ */
+
+#ifndef SCAN_PARTITION_H
+#define SCAN_PARTITION_H
+
+namespace scan {
+
+/*==============================================================
+ * block_range (the [pos0,pos1) block of part out of nparts)
+ *   The first n % nparts blocks get one extra element, so block
+ *   sizes differ by at most one and no block is left empty while
+ *   another has more than one element.
+ *==============================================================*/
+template <typename Size>
+inline void block_range(Size n, int nparts, int part, Size* pos0, Size* pos1) {
+  Size base = n / nparts;
+  Size extra = n % nparts;
+  *pos0 = part * base + (part < extra ? part : extra);
+  *pos1 = *pos0 + base + (part < extra ? 1 : 0);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_PARTITION_H */
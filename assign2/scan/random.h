@@ -0,0 +1,195 @@
+/*
+ *  scan/random.h - Counter-based random input generation.
+ */
+
+/*---------------------------------------------------------
+ *  Counter-Based Random Integers
+ *
+ *  Element i of the stream selected by seed is the i-th output of
+ *  SplitMix64 seeded with seed, computed directly from (seed, i):
+ *
+ *    z = seed + (i+1) * golden_gamma;  value = mix(z) >> 33
+ *
+ *  Values are uniform in [0, 2^31), the range of rand() on Linux.  There
+ *  is no generator state, so any thread or process can generate any slice
+ *  and the sequence does not depend on how the work is split.  The fill
+ *  loop has no carried dependency: the AVX2 and AVX-512 kernels (chosen at
+ *  run time like the scan kernels of scan/simd.h) mix 4 or 8 counters per
+ *  vector, building the 64-bit multiplies of the mix from 32x32->64 bit
+ *  products (_mm256_mul_epu32, _mm512_mul_epu32).
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_RANDOM_H
+#define SCAN_RANDOM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+#include "simd.h"
+
+namespace scan {
+
+/*==============================================================
+ * random_int (element i of the stream selected by seed)
+ *==============================================================*/
+inline uint64_t splitmix64(uint64_t seed, uint64_t i) {
+  uint64_t z = seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+inline long random_int(uint64_t seed, uint64_t i) {
+  return (long)(splitmix64(seed, i) >> 33);
+}
+
+namespace simd {
+
+template <typename T>
+inline void random_ints_scalar(uint64_t seed, uint64_t first_index, T* out, size_t n) {
+  for(size_t i=0;i<n;++i) out[i] = (T)(splitmix64(seed, first_index + i) >> 33);
+}
+
+#ifdef SCAN_SIMD_X86
+/*==============================================================
+ * mul64_avx2 / mul64_avx512 (a * c mod 2^64 in every lane, from
+ *   32x32->64 bit partial products: AVX2 and AVX-512F have no
+ *   64-bit multiply)
+ *==============================================================*/
+__attribute__((target("avx2")))
+inline __m256i mul64_avx2(__m256i a, uint64_t c) {
+  const __m256i c_lo = _mm256_set1_epi64x((long long)(c & 0xFFFFFFFFULL));
+  const __m256i c_hi = _mm256_set1_epi64x((long long)(c >> 32));
+  __m256i lo = _mm256_mul_epu32(a, c_lo);
+  __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), c_lo),
+                                   _mm256_mul_epu32(a, c_hi));
+  return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+/* GCC 12's AVX-512 intrinsics warn about their own undefined operand */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f")))
+inline __m512i mul64_avx512(__m512i a, uint64_t c) {
+  const __m512i c_lo = _mm512_set1_epi64((long long)(c & 0xFFFFFFFFULL));
+  const __m512i c_hi = _mm512_set1_epi64((long long)(c >> 32));
+  __m512i lo = _mm512_mul_epu32(a, c_lo);
+  __m512i cross = _mm512_add_epi64(_mm512_mul_epu32(_mm512_srli_epi64(a, 32), c_lo),
+                                   _mm512_mul_epu32(a, c_hi));
+  return _mm512_add_epi64(lo, _mm512_slli_epi64(cross, 32));
+}
+
+/* value of the counters z (mix(z) >> 33 of splitmix64) */
+__attribute__((target("avx2")))
+inline __m256i random_values_avx2(__m256i z) {
+  z = mul64_avx2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 30)), 0xBF58476D1CE4E5B9ULL);
+  z = mul64_avx2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 27)), 0x94D049BB133111EBULL);
+  return _mm256_srli_epi64(_mm256_xor_si256(z, _mm256_srli_epi64(z, 31)), 33);
+}
+
+__attribute__((target("avx512f")))
+inline __m512i random_values_avx512(__m512i z) {
+  z = mul64_avx512(_mm512_xor_si512(z, _mm512_srli_epi64(z, 30)), 0xBF58476D1CE4E5B9ULL);
+  z = mul64_avx512(_mm512_xor_si512(z, _mm512_srli_epi64(z, 27)), 0x94D049BB133111EBULL);
+  return _mm512_srli_epi64(_mm512_xor_si512(z, _mm512_srli_epi64(z, 31)), 33);
+}
+
+/* stores the values (< 2^31) of v as T: 64 and 32-bit integers
+   straight from the register, other types one by one */
+template <typename T>
+__attribute__((target("avx2")))
+inline void store_values_avx2(T* out, __m256i v) {
+  if( std::is_integral<T>::value && sizeof(T) == 8 ) {
+    _mm256_storeu_si256((__m256i*)out, v);
+  }
+  else if( std::is_integral<T>::value && sizeof(T) == 4 ) {
+    v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0));
+    _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(v));
+  }
+  else {
+    uint64_t values[4];
+    _mm256_storeu_si256((__m256i*)values, v);
+    for(int k=0;k<4;++k) out[k] = (T)values[k];
+  }
+}
+
+template <typename T>
+__attribute__((target("avx512f")))
+inline void store_values_avx512(T* out, __m512i v) {
+  if( std::is_integral<T>::value && sizeof(T) == 8 ) {
+    _mm512_storeu_si512(out, v);
+  }
+  else if( std::is_integral<T>::value && sizeof(T) == 4 ) {
+    _mm256_storeu_si256((__m256i*)out, _mm512_cvtepi64_epi32(v));
+  }
+  else {
+    uint64_t values[8];
+    _mm512_storeu_si512(values, v);
+    for(int k=0;k<8;++k) out[k] = (T)values[k];
+  }
+}
+
+/*==============================================================
+ * random_ints_avx2 / random_ints_avx512 (4 or 8 counters per
+ *   vector, advanced by 4 or 8 gammas; the tail is scalar)
+ *==============================================================*/
+template <typename T>
+__attribute__((target("avx2")))
+inline void random_ints_avx2(uint64_t seed, uint64_t first_index, T* out, size_t n) {
+  const uint64_t gamma = 0x9E3779B97F4A7C15ULL;
+  const uint64_t z0 = seed + (first_index + 1) * gamma;
+  __m256i z = _mm256_setr_epi64x((long long)z0, (long long)(z0 + gamma),
+                                 (long long)(z0 + 2*gamma), (long long)(z0 + 3*gamma));
+  const __m256i step = _mm256_set1_epi64x((long long)(4 * gamma));
+
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4) {
+    store_values_avx2(out + i, random_values_avx2(z));
+    z = _mm256_add_epi64(z, step);
+  }
+  random_ints_scalar(seed, first_index + i, out + i, n - i);
+}
+
+template <typename T>
+__attribute__((target("avx512f")))
+inline void random_ints_avx512(uint64_t seed, uint64_t first_index, T* out, size_t n) {
+  const uint64_t gamma = 0x9E3779B97F4A7C15ULL;
+  const uint64_t z0 = seed + (first_index + 1) * gamma;
+  __m512i z = _mm512_add_epi64(_mm512_set1_epi64((long long)z0),
+                               mul64_avx512(_mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7), gamma));
+  const __m512i step = _mm512_set1_epi64((long long)(8 * gamma));
+
+  size_t i = 0;
+  for(; i + 8 <= n; i += 8) {
+    store_values_avx512(out + i, random_values_avx512(z));
+    z = _mm512_add_epi64(z, step);
+  }
+  random_ints_scalar(seed, first_index + i, out + i, n - i);
+}
+
+#pragma GCC diagnostic pop
+#endif
+
+} /* namespace simd */
+
+/*==============================================================
+ * random_ints (fills out[0..n) with elements first_index.. of
+ *              the stream selected by seed)
+ *==============================================================*/
+template <typename T>
+inline void random_ints(uint64_t seed, uint64_t first_index, T* out, size_t n) {
+#ifdef SCAN_SIMD_X86
+  switch( simd::isa() ) {
+  case simd::avx512: simd::random_ints_avx512(seed, first_index, out, n); return;
+  case simd::avx2:   simd::random_ints_avx2(seed, first_index, out, n); return;
+  default:           break;
+  }
+#endif
+  simd::random_ints_scalar(seed, first_index, out, n);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_RANDOM_H */
@@ -0,0 +1,182 @@
+/*
+ *  scan/reproducible.h - Reproducible floating-point sums and prefix sums.
+ */
+
+/*---------------------------------------------------------
+ *  Reproducible Floating-Point Sums
+ *
+ *  Floating-point addition is not associative, so a parallel sum or prefix
+ *  sum of doubles changes with the number of threads or processes.
+ *  reproducible_inclusive_scan and reproducible_reduce return the same bits
+ *  for any backend, any number of threads or processes and any partition.
+ *
+ *  Every element is cut on a grid fixed by the whole sequence (binned
+ *  pre-rounding).  With max |x| < 2^e and n = 2^k elements (rounded up):
+ *
+ *    x * 2^s1  = hi + r,   hi = trunc(x * 2^s1), |r| < 1,  s1 = 62-k-e
+ *    r * 2^s2 ~= lo,       lo = trunc(r * 2^s2),           s2 = 61-k
+ *
+ *  so that no sum of n values of hi (or lo) exceeds 2^62.  hi and lo are
+ *  summed as 64-bit integers, which is exact and thus associative; prefix
+ *  i is (hi_i * 2^s2 + lo_i) * 2^-(s1+s2) in long double, rounded to T.
+ *  The truncation of lo loses less than 2^(2k-123) of max |x| per element,
+ *  and the conversion back about one ulp of the prefix: far below the
+ *  rounding error of a plain sum of doubles.
+ *
+ *  The grid needs max |x| first, so the input is read three times: max,
+ *  reduction of the bins of every block, scan seeded with the bins of the
+ *  preceding blocks (with MPI the max and the offsets are exchanged).
+ *  The input must be finite.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_REPRODUCIBLE_H
+#define SCAN_REPRODUCIBLE_H
+
+#include <stdint.h>
+#include <math.h>
+#include <iterator>
+#include <algorithm>
+#include "serial.h"
+
+namespace scan {
+
+/* Integer parts of a value on the grid */
+struct bins {
+  int64_t hi;
+  int64_t lo;
+};
+
+/* Exact sum of bins */
+struct bins_plus {
+  bins operator()(const bins& a, const bins& b) const {
+    bins r;
+    r.hi = a.hi + b.hi;
+    r.lo = a.lo + b.lo;
+    return r;
+  }
+};
+
+/* Grid of the bins, the same on every thread and process */
+struct bin_grid {
+  int s1, s2;
+  double scale1;     /* 2^s1, 0 when out of the range of normal doubles */
+  double scale2;     /* 2^s2 */
+  long double unit;  /* 2^-(s1+s2), always in the range of long double */
+};
+
+/*==============================================================
+ * make_bin_grid (grid for n elements of magnitude below
+ *                max_abs)
+ *==============================================================*/
+inline bin_grid make_bin_grid(double max_abs, long n) {
+  int e = 0, k = 0;
+  frexp(max_abs, &e);   /* max_abs < 2^e, e = 0 for 0 */
+  while( k < 62 && (1L << k) < n ) ++k;
+
+  bin_grid g;
+  g.s1 = 62 - k - e;
+  g.s2 = 61 - k;
+  g.scale1 = (g.s1 >= -1022 && g.s1 <= 1023) ? ldexp(1.0, g.s1) : 0.0;
+  g.scale2 = ldexp(1.0, g.s2);
+  g.unit = ldexpl(1.0L, -(g.s1 + g.s2));
+  return g;
+}
+
+/*==============================================================
+ * to_bins / from_bins (value on the grid, and a sum of bins
+ *                      rounded back to T)
+ *==============================================================*/
+template <typename T>
+inline bins to_bins(T x, const bin_grid& g) {
+  double t = g.scale1 != 0.0 ? (double)x * g.scale1 : ldexp((double)x, g.s1);
+  bins b;
+  b.hi = (int64_t)t;
+  b.lo = (int64_t)((t - (double)b.hi) * g.scale2);   /* t - hi is exact */
+  return b;
+}
+
+template <typename T>
+inline T from_bins(const bins& b, const bin_grid& g) {
+  /* hi * 2^s2 and lo are exact in the 64-bit significand of long double,
+     so is the scaling by a power of two; the sum is rounded, then the
+     conversion to T */
+  long double v = (long double)b.hi * g.scale2 + (long double)b.lo;
+  return (T)(v * g.unit);
+}
+
+namespace detail {
+
+/*==============================================================
+ * max_abs_serial (largest magnitude in [first,last), at least m)
+ *==============================================================*/
+template <typename InIt>
+inline double max_abs_serial(InIt first, InIt last, double m) {
+  for(; first != last; ++first) m = std::max(m, fabs((double)*first));
+  return m;
+}
+
+/*==============================================================
+ * reduce_bins (sum of the bins of [first,last))
+ *==============================================================*/
+template <typename InIt>
+inline bins reduce_bins(InIt first, InIt last, const bin_grid& g) {
+  bins acc = { 0, 0 };
+  for(; first != last; ++first) {
+    bins b = to_bins(*first, g);
+    acc.hi += b.hi;
+    acc.lo += b.lo;
+  }
+  return acc;
+}
+
+/*==============================================================
+ * reproducible_block (prefix sums of [first,last) seeded with
+ *                     the bins acc of the preceding elements;
+ *                     returns the bins of the total)
+ *==============================================================*/
+template <typename InIt, typename OutIt>
+inline bins reproducible_block(InIt first, InIt last, OutIt out, bins acc, const bin_grid& g) {
+  typedef typename std::iterator_traits<InIt>::value_type T;
+  for(; first != last; ++first, ++out) {
+    bins b = to_bins(*first, g);
+    acc.hi += b.hi;
+    acc.lo += b.lo;
+    *out = from_bins<T>(acc, g);
+  }
+  return acc;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * reproducible_inclusive_scan / reproducible_reduce (serial
+ *   backend; the total is stored in *total if not NULL)
+ *==============================================================*/
+template <typename InIt, typename OutIt>
+OutIt reproducible_inclusive_scan(const serial&, InIt first, InIt last, OutIt out,
+                                  typename std::iterator_traits<InIt>::value_type* total = NULL) {
+  typedef typename std::iterator_traits<InIt>::value_type T;
+  const long n = last - first;
+  bin_grid g = make_bin_grid(detail::max_abs_serial(first, last, 0.0), n);
+  bins zero = { 0, 0 };
+  bins acc = detail::reproducible_block(first, last, out, zero, g);
+  if( total ) *total = from_bins<T>(acc, g);
+  return out + n;
+}
+
+template <typename InIt, typename OutIt>
+OutIt reproducible_inclusive_scan(InIt first, InIt last, OutIt out) {
+  return scan::reproducible_inclusive_scan(serial(), first, last, out);
+}
+
+template <typename InIt>
+typename std::iterator_traits<InIt>::value_type
+reproducible_reduce(const serial&, InIt first, InIt last) {
+  typedef typename std::iterator_traits<InIt>::value_type T;
+  bin_grid g = make_bin_grid(detail::max_abs_serial(first, last, 0.0), last - first);
+  return from_bins<T>(detail::reduce_bins(first, last, g), g);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_REPRODUCIBLE_H */
@@ -0,0 +1,48 @@
+/*
+ *  scan/scan.h - Header-only parallel prefix scan library.
+ */
+
+/*---------------------------------------------------------
+ *  One entry point, several backends selected by a policy object:
+ *
+ *    scan::inclusive_scan(first, last, out, op, init);                 serial
+ *    scan::inclusive_scan(scan::serial(), first, last, out, op, init);  serial
+ *    scan::inclusive_scan(scan::openmp(4), first, last, out, op, init); OpenMP
+ *    scan::inclusive_scan(scan::mpi(comm), first, last, out, op, init); MPI
+ *    scan::inclusive_scan(scan::hybrid(scan::mpi(comm), scan::openmp(8)),
+ *                         first, last, out, op, init);                 MPI+OpenMP
+ *
+ *  exclusive_scan takes the same arguments; with any policy, a pointer
+ *  after init receives the total (on every process with MPI):
+ *
+ *    scan::exclusive_scan(scan::mpi(comm), first, last, out, op, init, &total);
+ *
+ *  segmented_inclusive_scan and segmented_exclusive_scan take the serial,
+ *  OpenMP and MPI policies and restart at segment heads (scan/segmented.h).
+ *
+ *  reproducible_inclusive_scan and reproducible_reduce sum floating-point
+ *  values to the same bits with any policy and any number of threads or
+ *  processes (scan/reproducible.h).
+ *
+ *  Every backend times its phases per thread once scan::timers_enable()
+ *  is called; scan::print_phase_report reports them (scan/timer.h).
+ *
+ *  The OpenMP backend is available when compiled with OpenMP enabled.
+ *  The MPI and hybrid backends live in scan/mpi.h and scan/hybrid.h and are
+ *  included explicitly by MPI programs, so that non-MPI programs do not
+ *  depend on mpi.h.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_SCAN_H
+#define SCAN_SCAN_H
+
+#include "serial.h"
+#include "partition.h"
+#include "segmented.h"
+#include "reproducible.h"
+
+#ifdef _OPENMP
+#include "openmp.h"
+#endif
+
+#endif /* SCAN_SCAN_H */
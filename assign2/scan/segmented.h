@@ -0,0 +1,199 @@
+/*
+ *  scan/segmented.h - Segmented prefix scans (restart at segment heads).
+ */
+
+/*---------------------------------------------------------
+ *  Segmented Prefix Scan
+ *
+ *  The sequence is cut into segments and every segment is scanned on its
+ *  own, e.g. running totals per user or row sums of a CSR matrix:
+ *
+ *    inclusive: out[i] = init op in[s] op ... op in[i]
+ *    exclusive: out[i] = init op in[s] op ... op in[i-1],  out[s] = init
+ *
+ *  where s is the head of the segment holding i.  Segments are given either
+ *  by flags (flags[i] != 0 starts a segment at i) or by the offsets of the
+ *  segment heads, as in a CSR row pointer; element 0 always starts one.
+ *  Empty segments, repeated offsets and offsets past the end are allowed.
+ *
+ *  In parallel every block (thread or process) scans its part on its own
+ *  and publishes a segment carry: whether it holds a head, and the fold
+ *  since its last head (or of the whole block).  Carries combine like
+ *
+ *    lo, hi  ->  hi                        if hi holds a head
+ *                (lo.head, lo op hi)       otherwise
+ *
+ *  which is associative, so the carry of the preceding blocks is found as
+ *  for a plain scan.  It is then folded into the elements of the block
+ *  before its first head only; segments may span any number of blocks.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_SEGMENTED_H
+#define SCAN_SEGMENTED_H
+
+#include <vector>
+#include "serial.h"
+
+namespace scan {
+
+namespace detail {
+
+/* Carry of a block of a segmented scan */
+template <typename T>
+struct segment {
+  int head;  /* the block holds a segment head */
+  T value;   /* fold since its last head (init included), or of the whole block */
+};
+
+/*==============================================================
+ * segment_op (combines the carry of a block with the carry of
+ *             the block following it)
+ *==============================================================*/
+template <typename Op>
+struct segment_op {
+  Op op;
+
+  explicit segment_op(Op op) : op(op) {
+  }
+
+  template <typename T>
+  segment<T> operator()(const segment<T>& lo, const segment<T>& hi) const {
+    if( hi.head ) return hi;
+    segment<T> r;
+    r.head = lo.head;
+    r.value = op(lo.value, hi.value);
+    return r;
+  }
+};
+
+/*==============================================================
+ * segmented_block (scans [pos0,pos1) as if no block preceded it;
+ *   at_start makes pos0 a head.  Returns the first head of the
+ *   block (pos1 if none) and its carry in *carry.  The elements
+ *   before the first head still lack the carry of the preceding
+ *   blocks; with Exclusive, out[pos0] is then left unwritten.)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename FlagIt, typename OutIt, typename Op,
+          typename T, typename Size>
+Size segmented_block(InIt first, FlagIt flags, OutIt out, Size pos0, Size pos1, Op op, T init,
+                     bool at_start, segment<T>* carry) {
+  Size first_head = pos1;
+  T acc = init;
+
+  for(Size i=pos0;i<pos1;++i) {
+    T x = first[i];   /* read before out[i] is written, out may be first */
+    bool head = flags[i] || (i == pos0 && at_start);
+    if( head && first_head == pos1 ) first_head = i;
+
+    if( Exclusive ) {
+      if( head ) acc = init;
+      if( i > pos0 || head ) out[i] = acc;
+      acc = (i == pos0 && !head) ? x : op(acc, x);
+    }
+    else {
+      if( head ) acc = op(init, x);
+      else acc = (i == pos0) ? x : op(acc, x);
+      out[i] = acc;
+    }
+  }
+
+  carry->head = first_head < pos1;
+  carry->value = acc;
+  return first_head;
+}
+
+/*==============================================================
+ * segmented_fixup (folds the carry of the preceding blocks into
+ *                  [pos0,first_head))
+ *==============================================================*/
+template <bool Exclusive, typename OutIt, typename Op, typename T, typename Size>
+inline void segmented_fixup(OutIt out, Size pos0, Size first_head, Op op, T offset) {
+  if( first_head == pos0 ) return;
+  if( Exclusive ) {
+    out[pos0] = offset;
+    add_offset(out+pos0+1, out+first_head, op, offset);
+  }
+  else {
+    add_offset(out+pos0, out+first_head, op, offset);
+  }
+}
+
+/*==============================================================
+ * offsets_to_flags (head flags of n elements from the offsets of
+ *                   the segment heads)
+ *==============================================================*/
+template <typename OffsetIt>
+std::vector<unsigned char> offsets_to_flags(OffsetIt offsets_first, OffsetIt offsets_last,
+                                            long n) {
+  std::vector<unsigned char> flags(n, 0);
+  for(; offsets_first != offsets_last; ++offsets_first) {
+    long pos = *offsets_first;
+    if( pos >= 0 && pos < n ) flags[pos] = 1;
+  }
+  return flags;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * segmented_inclusive_scan / segmented_exclusive_scan
+ *   (serial backend, segments given by flags)
+ *==============================================================*/
+template <typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+inline OutIt segmented_inclusive_scan(const serial&, InIt first, InIt last, FlagIt flags,
+                                      OutIt out, Op op, T init) {
+  detail::segment<T> carry;
+  detail::segmented_block<false>(first, flags, out, 0L, (long)(last - first), op, init,
+                                 true, &carry);
+  return out + (last - first);
+}
+
+template <typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+inline OutIt segmented_exclusive_scan(const serial&, InIt first, InIt last, FlagIt flags,
+                                      OutIt out, Op op, T init) {
+  detail::segment<T> carry;
+  detail::segmented_block<true>(first, flags, out, 0L, (long)(last - first), op, init,
+                                true, &carry);
+  return out + (last - first);
+}
+
+template <typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+inline OutIt segmented_inclusive_scan(InIt first, InIt last, FlagIt flags, OutIt out,
+                                      Op op, T init) {
+  return scan::segmented_inclusive_scan(serial(), first, last, flags, out, op, init);
+}
+
+template <typename InIt, typename FlagIt, typename OutIt, typename Op, typename T>
+inline OutIt segmented_exclusive_scan(InIt first, InIt last, FlagIt flags, OutIt out,
+                                      Op op, T init) {
+  return scan::segmented_exclusive_scan(serial(), first, last, flags, out, op, init);
+}
+
+/*==============================================================
+ * segmented_inclusive_scan / segmented_exclusive_scan
+ *   (any backend, segments given by the offsets of their heads
+ *    in [first,last); with MPI, offsets into the local slice)
+ *==============================================================*/
+template <typename Policy, typename InIt, typename OffsetIt, typename OutIt, typename Op,
+          typename T>
+OutIt segmented_inclusive_scan(const Policy& policy, InIt first, InIt last,
+                               OffsetIt offsets_first, OffsetIt offsets_last,
+                               OutIt out, Op op, T init) {
+  std::vector<unsigned char> flags =
+    detail::offsets_to_flags(offsets_first, offsets_last, last - first);
+  return segmented_inclusive_scan(policy, first, last, flags.begin(), out, op, init);
+}
+
+template <typename Policy, typename InIt, typename OffsetIt, typename OutIt, typename Op,
+          typename T>
+OutIt segmented_exclusive_scan(const Policy& policy, InIt first, InIt last,
+                               OffsetIt offsets_first, OffsetIt offsets_last,
+                               OutIt out, Op op, T init) {
+  std::vector<unsigned char> flags =
+    detail::offsets_to_flags(offsets_first, offsets_last, last - first);
+  return segmented_exclusive_scan(policy, first, last, flags.begin(), out, op, init);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_SEGMENTED_H */
@@ -0,0 +1,204 @@
+/*
+ *  scan/serial.h - Serial backend of the prefix scan library.
+ */
+
+/*---------------------------------------------------------
+ *  Serial Prefix Scan
+ *
+ *  inclusive: out[i] = init op in[0] op in[1] op ... op in[i]
+ *  exclusive: out[i] = init op in[0] op ... op in[i-1],  out[0] = init
+ *
+ *  Both are computed directly, not derived one from the other.  Every
+ *  backend can also return the total (init op in[0] op ... op in[n-1]) in
+ *  *total, without another pass; with MPI every process gets the total of
+ *  the whole distributed sequence.
+ *
+ *  The accumulator and the output have the type of init (like
+ *  std::inclusive_scan), so the input may be narrower: int32 or uint16
+ *  counts can be summed into int64 without widening them in memory first.
+ *  The SIMD kernels widen integer inputs of 8, 16 or 32 bits as they load.
+ *  inclusive_scan is out of place: it reads [first,last) once and writes
+ *  [out,out+n) once, with no copy of the input.  out may also be first;
+ *  inclusive_scan_inplace spells that case out.  Other overlaps are not
+ *  allowed.  All backends expect random access iterators.
+ *
+ *  The policies pick regular or streaming (non-temporal) stores for the
+ *  output; store_automatic streams when an out-of-place output is larger
+ *  than the last level cache.  Only the SIMD integer kernels stream.
+ *
+ *  op must be associative; scan/monoid.h names the common operators and
+ *  their identities, and those on 32-bit and 64-bit integers are scanned
+ *  by the SIMD kernels.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_SERIAL_H
+#define SCAN_SERIAL_H
+
+#include <iterator>
+#include "simd.h"
+#include "timer.h"
+
+namespace scan {
+
+/* Stores of the output */
+enum store_mode { store_automatic, store_regular, store_streaming };
+
+/* Policy selecting the serial backend */
+struct serial {
+  store_mode stores;
+
+  explicit serial(store_mode stores = store_automatic) : stores(stores) {
+  }
+};
+
+namespace detail {
+
+/*==============================================================
+ * use_streaming (whether an output of n elements of T is
+ *                written with non-temporal stores)
+ *==============================================================*/
+template <typename T>
+inline bool use_streaming(store_mode stores, long n) {
+  if( stores == store_automatic ) return n * (long)sizeof(T) > simd::llc_bytes();
+  return stores == store_streaming;
+}
+
+/*==============================================================
+ * scan_serial (scans [first,last) into out starting from acc,
+ *              returns the final value of the accumulator)
+ *==============================================================*/
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline T scan_serial(InIt first, InIt last, OutIt out, Op op, T acc, bool, std::false_type) {
+  for(; first != last; ++first, ++out) {
+    acc = op(acc, *first);
+    *out = acc;
+  }
+  return acc;
+}
+
+/* Integers over contiguous storage with a known operator use the SIMD kernels */
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline T scan_serial(InIt first, InIt last, OutIt out, Op, T acc, bool stream, std::true_type) {
+  if( first == last ) return acc;
+  return simd::scan_op<simd::op_kind_of<Op, T>::value, false>(&*first, &*out, last - first, acc,
+                                                              stream);
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline T scan_serial(InIt first, InIt last, OutIt out, Op op, T acc, bool stream = false) {
+  return scan_serial(first, last, out, op, acc, stream,
+                     typename simd::has_kernel<InIt, OutIt, Op, T>::type());
+}
+
+/*==============================================================
+ * exclusive_serial (exclusive scan of [first,last) into out
+ *                   starting from acc, returns the final value of
+ *                   the accumulator, i.e. the total)
+ *==============================================================*/
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline T exclusive_serial(InIt first, InIt last, OutIt out, Op op, T acc, bool, std::false_type) {
+  for(; first != last; ++first, ++out) {
+    T x = *first;   /* read before out is written, out may be first */
+    *out = acc;
+    acc = op(acc, x);
+  }
+  return acc;
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline T exclusive_serial(InIt first, InIt last, OutIt out, Op, T acc, bool stream,
+                          std::true_type) {
+  if( first == last ) return acc;
+  return simd::scan_op<simd::op_kind_of<Op, T>::value, true>(&*first, &*out, last - first, acc,
+                                                             stream);
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline T exclusive_serial(InIt first, InIt last, OutIt out, Op op, T acc, bool stream = false) {
+  return exclusive_serial(first, last, out, op, acc, stream,
+                          typename simd::has_kernel<InIt, OutIt, Op, T>::type());
+}
+
+/*==============================================================
+ * scan_block (inclusive or exclusive scan of a block, selected
+ *             at compile time; returns the total)
+ *==============================================================*/
+template <bool Exclusive, typename InIt, typename OutIt, typename Op, typename T>
+inline T scan_block(InIt first, InIt last, OutIt out, Op op, T acc, bool stream = false) {
+  if( Exclusive ) return exclusive_serial(first, last, out, op, acc, stream);
+  return scan_serial(first, last, out, op, acc, stream);
+}
+
+/*==============================================================
+ * add_offset (out[i] = offset op out[i] over [out,out_last))
+ *==============================================================*/
+template <typename OutIt, typename Op, typename T>
+inline void add_offset(OutIt out, OutIt out_last, Op op, T offset, bool, std::false_type) {
+  for(; out != out_last; ++out) *out = op(offset, *out);
+}
+
+template <typename OutIt, typename Op, typename T>
+inline void add_offset(OutIt out, OutIt out_last, Op, T offset, bool stream, std::true_type) {
+  if( out == out_last ) return;
+  simd::offset_op<simd::op_kind_of<Op, T>::value>(&*out, out_last - out, offset, stream);
+}
+
+template <typename OutIt, typename Op, typename T>
+inline void add_offset(OutIt out, OutIt out_last, Op op, T offset, bool stream = false) {
+  add_offset(out, out_last, op, offset, stream,
+             typename simd::has_kernel<OutIt, OutIt, Op, T>::type());
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * inclusive_scan / exclusive_scan (serial backend; the total is
+ *                                  stored in *total if not NULL)
+ *==============================================================*/
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline OutIt inclusive_scan(const serial& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                            T* total = NULL) {
+  phase_timer timer(phase_local_scan);
+  T acc = detail::scan_serial(first, last, out, op, init,
+                              detail::use_streaming<T>(policy.stores, last - first));
+  if( total ) *total = acc;
+  return out + (last - first);
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline OutIt exclusive_scan(const serial& policy, InIt first, InIt last, OutIt out, Op op, T init,
+                            T* total = NULL) {
+  phase_timer timer(phase_local_scan);
+  T acc = detail::exclusive_serial(first, last, out, op, init,
+                                   detail::use_streaming<T>(policy.stores, last - first));
+  if( total ) *total = acc;
+  return out + (last - first);
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline OutIt inclusive_scan(InIt first, InIt last, OutIt out, Op op, T init) {
+  return scan::inclusive_scan(serial(), first, last, out, op, init);
+}
+
+template <typename InIt, typename OutIt, typename Op, typename T>
+inline OutIt exclusive_scan(InIt first, InIt last, OutIt out, Op op, T init) {
+  return scan::exclusive_scan(serial(), first, last, out, op, init);
+}
+
+/*==============================================================
+ * inclusive_scan_inplace (overwrites [first,last) with its scan;
+ *                         any backend)
+ *==============================================================*/
+template <typename Policy, typename It, typename Op, typename T>
+inline It inclusive_scan_inplace(const Policy& policy, It first, It last, Op op, T init) {
+  return inclusive_scan(policy, first, last, first, op, init);
+}
+
+template <typename It, typename Op, typename T>
+inline It inclusive_scan_inplace(It first, It last, Op op, T init) {
+  return scan::inclusive_scan(serial(), first, last, first, op, init);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_SERIAL_H */
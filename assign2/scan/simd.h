@@ -0,0 +1,577 @@
+/*
+ *  scan/simd.h - In-register SIMD prefix scan kernels with runtime dispatch.
+ */
+
+/*---------------------------------------------------------
+ *  SIMD Prefix Scan
+ *
+ *  1. Load a vector of 8/16 (int32) or 4/8 (int64) integers
+ *  2. Scan it inside the register by log-step shift-and-combine, shifting
+ *     in the identity of the operator
+ *  3. Combine the carry (running total of the preceding vectors) and store
+ *  4. Advance the carry by the last lane of the scanned vector
+ *  Exclusive scans store the scanned vector shifted up by one lane (the
+ *  identity in lane 0) instead, which costs one shuffle per vector.
+ *
+ *  One kernel per instruction set serves every operator of a known kind
+ *  (sum, 32-bit product, min, max, or, xor, and; see scan/monoid.h): the
+ *  kind is a template argument, so the operator is resolved at compile
+ *  time.  The carry chain is a single operation per vector; the
+ *  in-register scan of the next vector does not depend on it.  The
+ *  instruction set is picked once at run time (AVX-512F, AVX2 or scalar
+ *  code); the environment variable SCAN_SIMD=scalar|avx2|avx512 lowers the
+ *  choice, e.g. for benchmarking.
+ *
+ *  The input may be a narrower integer than the output and the carry
+ *  (e.g. uint16 or int32 counts summed into int64): the kernels load
+ *  a vector's worth of narrow elements and sign or zero extend them (as
+ *  the input type is signed or not) before the scan, so memory and the
+ *  network only carry the narrow elements.
+ *
+ *  Streaming kernels write the output with non-temporal stores: the lines
+ *  are not read for ownership and do not evict the input from the cache.
+ *  This pays off for outputs much larger than the last level cache that
+ *  are not read again soon; llc_bytes() reports the size to compare with.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_SIMD_H
+#define SCAN_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include <limits>
+#include "monoid.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace scan {
+namespace simd {
+
+enum isa_t { scalar = 0, avx2 = 1, avx512 = 2 };
+
+/*==============================================================
+ * detect_isa (best instruction set supported by this CPU)
+ *==============================================================*/
+inline isa_t detect_isa() {
+  isa_t best = scalar;
+#ifdef SCAN_SIMD_X86
+  __builtin_cpu_init();
+  if( __builtin_cpu_supports("avx2") ) best = avx2;
+  if( __builtin_cpu_supports("avx512f") ) best = avx512;
+#endif
+  const char* env = getenv("SCAN_SIMD");
+  if( env != NULL ) {
+    isa_t requested = best;
+    if( strcmp(env, "scalar") == 0 ) requested = scalar;
+    else if( strcmp(env, "avx2") == 0 ) requested = avx2;
+    else if( strcmp(env, "avx512") == 0 ) requested = avx512;
+    if( requested < best ) best = requested;
+  }
+  return best;
+}
+
+/* Instruction set used by the kernels, detected on first use */
+inline isa_t isa() {
+  static const isa_t selected = detect_isa();
+  return selected;
+}
+
+inline const char* isa_name(isa_t i) {
+  return i == avx512 ? "avx512" : (i == avx2 ? "avx2" : "scalar");
+}
+
+/*==============================================================
+ * detect_llc_bytes (size of the last level cache; sysconf,
+ *                   then sysfs, then a guess of 8MB)
+ *==============================================================*/
+inline long detect_llc_bytes() {
+  long bytes = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+  bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if( bytes <= 0 ) bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+  for(int index=3; bytes <= 0 && index >= 2; --index) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+    FILE* f = fopen(path, "r");
+    if( f == NULL ) continue;
+    long size;
+    char unit = 0;
+    if( fscanf(f, "%ld%c", &size, &unit) >= 1 )
+      bytes = size * (unit == 'K' ? 1024L : (unit == 'M' ? 1024L*1024 : 1L));
+    fclose(f);
+  }
+  return bytes > 0 ? bytes : 8L*1024*1024;
+}
+
+/* Size of the last level cache, detected on first use */
+inline long llc_bytes() {
+  static const long selected = detect_llc_bytes();
+  return selected;
+}
+
+/*==============================================================
+ * Operators with a kernel (see scan/monoid.h)
+ *==============================================================*/
+enum op_kind { op_none, op_plus, op_multiplies, op_min, op_max, op_or, op_xor, op_and };
+
+template <typename Op, typename T>
+struct op_kind_of : std::integral_constant<int, op_none> {
+};
+
+template <typename T> struct op_kind_of<std::plus<T>, T> : std::integral_constant<int, op_plus> {};
+template <typename T> struct op_kind_of<std::multiplies<T>, T> : std::integral_constant<int, op_multiplies> {};
+template <typename T> struct op_kind_of<std::bit_or<T>, T> : std::integral_constant<int, op_or> {};
+template <typename T> struct op_kind_of<std::bit_xor<T>, T> : std::integral_constant<int, op_xor> {};
+template <typename T> struct op_kind_of<std::bit_and<T>, T> : std::integral_constant<int, op_and> {};
+template <typename T> struct op_kind_of<scan::sum<T>, T> : std::integral_constant<int, op_plus> {};
+template <typename T> struct op_kind_of<scan::product<T>, T> : std::integral_constant<int, op_multiplies> {};
+template <typename T> struct op_kind_of<scan::minimum<T>, T> : std::integral_constant<int, op_min> {};
+template <typename T> struct op_kind_of<scan::maximum<T>, T> : std::integral_constant<int, op_max> {};
+template <typename T> struct op_kind_of<scan::bit_or<T>, T> : std::integral_constant<int, op_or> {};
+template <typename T> struct op_kind_of<scan::bit_xor<T>, T> : std::integral_constant<int, op_xor> {};
+template <typename T> struct op_kind_of<scan::bit_and<T>, T> : std::integral_constant<int, op_and> {};
+
+/*==============================================================
+ * apply_op / op_identity (scalar operator and identity of a kind;
+ *                         sums and products wrap around)
+ *==============================================================*/
+template <int Kind, typename I>
+inline I apply_op(I a, I b) {
+  typedef typename std::make_unsigned<I>::type U;
+  switch( Kind ) {
+  case op_multiplies: return (I)((U)a * (U)b);
+  case op_min:        return b < a ? b : a;
+  case op_max:        return a < b ? b : a;
+  case op_or:         return a | b;
+  case op_xor:        return a ^ b;
+  case op_and:        return a & b;
+  default:            return (I)((U)a + (U)b);
+  }
+}
+
+template <int Kind, typename I>
+inline I op_identity() {
+  switch( Kind ) {
+  case op_multiplies: return 1;
+  case op_min:        return std::numeric_limits<I>::max();
+  case op_max:        return std::numeric_limits<I>::min();
+  case op_and:        return ~I(0);
+  default:            return 0;
+  }
+}
+
+/*==============================================================
+ * scalar kernels (fallback, also handle the tails; Exclusive
+ *                 stores the accumulator before each element)
+ *==============================================================*/
+template <int Kind, bool Exclusive, typename In, typename I>
+inline I scan_op_scalar(const In* in, I* out, size_t n, I acc) {
+  for(size_t i=0;i<n;++i) {
+    I x = (I)in[i];
+    if( Exclusive ) out[i] = acc;
+    acc = apply_op<Kind>(acc, x);
+    if( !Exclusive ) out[i] = acc;
+  }
+  return acc;
+}
+
+template <int Kind, typename I>
+inline void offset_op_scalar(I* out, size_t n, I offset) {
+  for(size_t i=0;i<n;++i) out[i] = apply_op<Kind>(offset, out[i]);
+}
+
+#ifdef SCAN_SIMD_X86
+
+/*==============================================================
+ * aligned_head (elements to scan before out+i is aligned on
+ *               align bytes; n if it never is)
+ *==============================================================*/
+template <typename I>
+inline size_t aligned_head(const I* out, size_t n, size_t align) {
+  size_t misalign = (size_t)out & (align - 1);
+  if( misalign == 0 ) return 0;
+  if( misalign % sizeof(I) != 0 ) return n;
+  size_t head = (align - misalign) / sizeof(I);
+  return head < n ? head : n;
+}
+
+/*==============================================================
+ * AVX2 kernels
+ *   The in-register scan shifts the vector up by 1, 2 (and 4)
+ *   lanes, filling with the identity, and combines; the shifts
+ *   stay within 128-bit lanes but for one cross-lane step.
+ *==============================================================*/
+template <bool Stream>
+__attribute__((target("avx2")))
+inline void store_avx2(void* p, __m256i x) {
+  if( Stream ) _mm256_stream_si256((__m256i*)p, x);
+  else _mm256_storeu_si256((__m256i*)p, x);
+}
+
+template <typename I>
+__attribute__((target("avx2")))
+inline __m256i set1_avx2(I x) {
+  return sizeof(I) == 8 ? _mm256_set1_epi64x(x) : _mm256_set1_epi32(x);
+}
+
+/* 32/sizeof(I) elements of In at in, widened to lanes of I */
+template <typename In, typename I>
+__attribute__((target("avx2")))
+inline __m256i load_avx2(const In* in) {
+  const bool sign = std::is_signed<In>::value;
+  if( sizeof(In) == sizeof(I) ) return _mm256_loadu_si256((const __m256i*)in);
+  if( sizeof(I) == 8 ) {
+    if( sizeof(In) == 4 ) {
+      __m128i x = _mm_loadu_si128((const __m128i*)in);
+      return sign ? _mm256_cvtepi32_epi64(x) : _mm256_cvtepu32_epi64(x);
+    }
+    if( sizeof(In) == 2 ) {
+      __m128i x = _mm_loadl_epi64((const __m128i*)in);
+      return sign ? _mm256_cvtepi16_epi64(x) : _mm256_cvtepu16_epi64(x);
+    }
+    int32_t bytes;
+    memcpy(&bytes, in, 4);
+    __m128i x = _mm_cvtsi32_si128(bytes);
+    return sign ? _mm256_cvtepi8_epi64(x) : _mm256_cvtepu8_epi64(x);
+  }
+  if( sizeof(In) == 2 ) {
+    __m128i x = _mm_loadu_si128((const __m128i*)in);
+    return sign ? _mm256_cvtepi16_epi32(x) : _mm256_cvtepu16_epi32(x);
+  }
+  __m128i x = _mm_loadl_epi64((const __m128i*)in);
+  return sign ? _mm256_cvtepi8_epi32(x) : _mm256_cvtepu8_epi32(x);
+}
+
+/* a > b on 64-bit lanes, signed or not (AVX2 only compares signed) */
+template <typename I>
+__attribute__((target("avx2")))
+inline __m256i cmpgt_avx2_64(__m256i a, __m256i b) {
+  if( std::is_signed<I>::value ) return _mm256_cmpgt_epi64(a, b);
+  const __m256i sign = _mm256_set1_epi64x(std::numeric_limits<long long>::min());
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+}
+
+template <int Kind, typename I>
+__attribute__((target("avx2")))
+inline __m256i op_avx2(__m256i a, __m256i b) {
+  const bool wide = sizeof(I) == 8;
+  const bool sign = std::is_signed<I>::value;
+  switch( Kind ) {
+  case op_multiplies: return _mm256_mullo_epi32(a, b);  /* 32-bit only */
+  case op_min:
+    if( wide ) return _mm256_blendv_epi8(a, b, cmpgt_avx2_64<I>(a, b));
+    return sign ? _mm256_min_epi32(a, b) : _mm256_min_epu32(a, b);
+  case op_max:
+    if( wide ) return _mm256_blendv_epi8(b, a, cmpgt_avx2_64<I>(a, b));
+    return sign ? _mm256_max_epi32(a, b) : _mm256_max_epu32(a, b);
+  case op_or:         return _mm256_or_si256(a, b);
+  case op_xor:        return _mm256_xor_si256(a, b);
+  case op_and:        return _mm256_and_si256(a, b);
+  default:            return wide ? _mm256_add_epi64(a, b) : _mm256_add_epi32(a, b);
+  }
+}
+
+/* inclusive scan of the lanes of x */
+template <int Kind, typename I>
+__attribute__((target("avx2")))
+inline __m256i scan_avx2(__m256i x, __m256i id) {
+  if( sizeof(I) == 8 ) {
+    x = op_avx2<Kind, I>(x, _mm256_alignr_epi8(x, id, 8));
+    __m256i t = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1,1,0,0));
+    return op_avx2<Kind, I>(x, _mm256_blend_epi32(id, t, 0xF0));
+  }
+  /* scan within each 128-bit lane */
+  x = op_avx2<Kind, I>(x, _mm256_alignr_epi8(x, id, 12));
+  x = op_avx2<Kind, I>(x, _mm256_alignr_epi8(x, id, 8));
+  /* carry the low lane total into the high lane */
+  __m256i t = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3,3,3,3));
+  return op_avx2<Kind, I>(x, _mm256_permute2x128_si256(id, t, 0x20));
+}
+
+/* x shifted up by one lane, the identity in lane 0 (inclusive to exclusive) */
+template <typename I>
+__attribute__((target("avx2")))
+inline __m256i shift1_avx2(__m256i x, __m256i id) {
+  if( sizeof(I) == 8 )
+    return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2,1,0,0)), id, 0x03);
+  const __m256i up = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+  return _mm256_blend_epi32(_mm256_permutevar8x32_epi32(x, up), id, 0x01);
+}
+
+/* last lane of x in every lane */
+template <typename I>
+__attribute__((target("avx2")))
+inline __m256i last_avx2(__m256i x) {
+  if( sizeof(I) == 8 ) return _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3,3,3,3));
+  return _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7));
+}
+
+template <int Kind, bool Exclusive, bool Stream, typename In, typename I>
+__attribute__((target("avx2")))
+inline I scan_op_avx2(const In* in, I* out, size_t n, I acc) {
+  const size_t lanes = 32 / sizeof(I);
+  const __m256i id = set1_avx2(op_identity<Kind, I>());
+  size_t i = Stream ? aligned_head(out, n, 32) : 0;
+  acc = scan_op_scalar<Kind, Exclusive>(in, out, i, acc);
+  __m256i carry = set1_avx2(acc);
+  for(; i+lanes<=n; i+=lanes) {
+    __m256i x = scan_avx2<Kind, I>(load_avx2<In, I>(in+i), id);
+    __m256i y = Exclusive ? shift1_avx2<I>(x, id) : x;
+    store_avx2<Stream>(out+i, op_avx2<Kind, I>(carry, y));
+    carry = op_avx2<Kind, I>(carry, last_avx2<I>(x));
+  }
+  if( Stream ) _mm_sfence();
+  acc = sizeof(I) == 8 ? (I)_mm_cvtsi128_si64(_mm256_castsi256_si128(carry))
+                       : (I)_mm_cvtsi128_si32(_mm256_castsi256_si128(carry));
+  return scan_op_scalar<Kind, Exclusive>(in+i, out+i, n-i, acc);
+}
+
+template <int Kind, bool Stream, typename I>
+__attribute__((target("avx2")))
+inline void offset_op_avx2(I* out, size_t n, I offset) {
+  const size_t lanes = 32 / sizeof(I);
+  size_t i = Stream ? aligned_head(out, n, 32) : 0;
+  offset_op_scalar<Kind>(out, i, offset);
+  const __m256i ps = set1_avx2(offset);
+  for(; i+lanes<=n; i+=lanes) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(out+i));
+    store_avx2<Stream>(out+i, op_avx2<Kind, I>(ps, x));
+  }
+  if( Stream ) _mm_sfence();
+  offset_op_scalar<Kind>(out+i, n-i, offset);
+}
+
+/*==============================================================
+ * AVX-512 kernels
+ *==============================================================*/
+
+/* GCC 12 warns about _mm512_undefined_* inside its own intrinsics */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+template <bool Stream>
+__attribute__((target("avx512f")))
+inline void store_avx512(void* p, __m512i x) {
+  if( Stream ) _mm512_stream_si512((__m512i*)p, x);
+  else _mm512_storeu_si512(p, x);
+}
+
+template <typename I>
+__attribute__((target("avx512f")))
+inline __m512i set1_avx512(I x) {
+  return sizeof(I) == 8 ? _mm512_set1_epi64(x) : _mm512_set1_epi32(x);
+}
+
+/* 64/sizeof(I) elements of In at in, widened to lanes of I */
+template <typename In, typename I>
+__attribute__((target("avx512f")))
+inline __m512i load_avx512(const In* in) {
+  const bool sign = std::is_signed<In>::value;
+  if( sizeof(In) == sizeof(I) ) return _mm512_loadu_si512((const void*)in);
+  if( sizeof(I) == 8 ) {
+    if( sizeof(In) == 4 ) {
+      __m256i x = _mm256_loadu_si256((const __m256i*)in);
+      return sign ? _mm512_cvtepi32_epi64(x) : _mm512_cvtepu32_epi64(x);
+    }
+    if( sizeof(In) == 2 ) {
+      __m128i x = _mm_loadu_si128((const __m128i*)in);
+      return sign ? _mm512_cvtepi16_epi64(x) : _mm512_cvtepu16_epi64(x);
+    }
+    __m128i x = _mm_loadl_epi64((const __m128i*)in);
+    return sign ? _mm512_cvtepi8_epi64(x) : _mm512_cvtepu8_epi64(x);
+  }
+  if( sizeof(In) == 2 ) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)in);
+    return sign ? _mm512_cvtepi16_epi32(x) : _mm512_cvtepu16_epi32(x);
+  }
+  __m128i x = _mm_loadu_si128((const __m128i*)in);
+  return sign ? _mm512_cvtepi8_epi32(x) : _mm512_cvtepu8_epi32(x);
+}
+
+template <int Kind, typename I>
+__attribute__((target("avx512f")))
+inline __m512i op_avx512(__m512i a, __m512i b) {
+  const bool wide = sizeof(I) == 8;
+  const bool sign = std::is_signed<I>::value;
+  switch( Kind ) {
+  case op_multiplies: return _mm512_mullo_epi32(a, b);  /* 32-bit only */
+  case op_min:
+    if( wide ) return sign ? _mm512_min_epi64(a, b) : _mm512_min_epu64(a, b);
+    return sign ? _mm512_min_epi32(a, b) : _mm512_min_epu32(a, b);
+  case op_max:
+    if( wide ) return sign ? _mm512_max_epi64(a, b) : _mm512_max_epu64(a, b);
+    return sign ? _mm512_max_epi32(a, b) : _mm512_max_epu32(a, b);
+  case op_or:         return _mm512_or_si512(a, b);
+  case op_xor:        return _mm512_xor_si512(a, b);
+  case op_and:        return _mm512_and_si512(a, b);
+  default:            return wide ? _mm512_add_epi64(a, b) : _mm512_add_epi32(a, b);
+  }
+}
+
+/* inclusive scan of the lanes of x: x op= x shifted up by 1, 2, 4 (, 8) lanes */
+template <int Kind, typename I>
+__attribute__((target("avx512f")))
+inline __m512i scan_avx512(__m512i x, __m512i id) {
+  if( sizeof(I) == 8 ) {
+    x = op_avx512<Kind, I>(x, _mm512_alignr_epi64(x, id, 7));
+    x = op_avx512<Kind, I>(x, _mm512_alignr_epi64(x, id, 6));
+    return op_avx512<Kind, I>(x, _mm512_alignr_epi64(x, id, 4));
+  }
+  x = op_avx512<Kind, I>(x, _mm512_alignr_epi32(x, id, 15));
+  x = op_avx512<Kind, I>(x, _mm512_alignr_epi32(x, id, 14));
+  x = op_avx512<Kind, I>(x, _mm512_alignr_epi32(x, id, 12));
+  return op_avx512<Kind, I>(x, _mm512_alignr_epi32(x, id, 8));
+}
+
+/* x shifted up by one lane, the identity in lane 0 (inclusive to exclusive) */
+template <typename I>
+__attribute__((target("avx512f")))
+inline __m512i shift1_avx512(__m512i x, __m512i id) {
+  if( sizeof(I) == 8 ) return _mm512_alignr_epi64(x, id, 7);
+  return _mm512_alignr_epi32(x, id, 15);
+}
+
+/* last lane of x in every lane */
+template <typename I>
+__attribute__((target("avx512f")))
+inline __m512i last_avx512(__m512i x) {
+  if( sizeof(I) == 8 ) return _mm512_permutexvar_epi64(_mm512_set1_epi64(7), x);
+  return _mm512_permutexvar_epi32(_mm512_set1_epi32(15), x);
+}
+
+template <int Kind, bool Exclusive, bool Stream, typename In, typename I>
+__attribute__((target("avx512f")))
+inline I scan_op_avx512(const In* in, I* out, size_t n, I acc) {
+  const size_t lanes = 64 / sizeof(I);
+  const __m512i id = set1_avx512(op_identity<Kind, I>());
+  size_t i = Stream ? aligned_head(out, n, 64) : 0;
+  acc = scan_op_scalar<Kind, Exclusive>(in, out, i, acc);
+  __m512i carry = set1_avx512(acc);
+  for(; i+lanes<=n; i+=lanes) {
+    __m512i x = scan_avx512<Kind, I>(load_avx512<In, I>(in+i), id);
+    __m512i y = Exclusive ? shift1_avx512<I>(x, id) : x;
+    store_avx512<Stream>(out+i, op_avx512<Kind, I>(carry, y));
+    carry = op_avx512<Kind, I>(carry, last_avx512<I>(x));
+  }
+  if( Stream ) _mm_sfence();
+  acc = sizeof(I) == 8 ? (I)_mm_cvtsi128_si64(_mm512_castsi512_si128(carry))
+                       : (I)_mm_cvtsi128_si32(_mm512_castsi512_si128(carry));
+  return scan_op_scalar<Kind, Exclusive>(in+i, out+i, n-i, acc);
+}
+
+template <int Kind, bool Stream, typename I>
+__attribute__((target("avx512f")))
+inline void offset_op_avx512(I* out, size_t n, I offset) {
+  const size_t lanes = 64 / sizeof(I);
+  size_t i = Stream ? aligned_head(out, n, 64) : 0;
+  offset_op_scalar<Kind>(out, i, offset);
+  const __m512i ps = set1_avx512(offset);
+  for(; i+lanes<=n; i+=lanes) {
+    __m512i x = _mm512_loadu_si512((const void*)(out+i));
+    store_avx512<Stream>(out+i, op_avx512<Kind, I>(ps, x));
+  }
+  if( Stream ) _mm_sfence();
+  offset_op_scalar<Kind>(out+i, n-i, offset);
+}
+
+#pragma GCC diagnostic pop
+
+#endif /* SCAN_SIMD_X86 */
+
+/*==============================================================
+ * scan_op (dispatches to the best kernel, returns the final
+ *          value of the accumulator; Exclusive selects the
+ *          exclusive scan, stream non-temporal stores of the output;
+ *          In may be narrower than I)
+ *   In-place scans never stream: the line was just read into
+ *   the cache.
+ *==============================================================*/
+template <int Kind, bool Exclusive, typename In, typename I>
+inline I scan_op(const In* in, I* out, size_t n, I acc, bool stream = false) {
+  stream = stream && (const void*)in != (const void*)out;
+#ifdef SCAN_SIMD_X86
+  switch( isa() ) {
+  case avx512:
+    return stream ? scan_op_avx512<Kind, Exclusive, true>(in, out, n, acc)
+                  : scan_op_avx512<Kind, Exclusive, false>(in, out, n, acc);
+  case avx2:
+    return stream ? scan_op_avx2<Kind, Exclusive, true>(in, out, n, acc)
+                  : scan_op_avx2<Kind, Exclusive, false>(in, out, n, acc);
+  default:
+    break;
+  }
+#endif
+  return scan_op_scalar<Kind, Exclusive>(in, out, n, acc);
+}
+
+/*==============================================================
+ * offset_op (out[i] = offset op out[i]; the add-back pass of a
+ *            scan)
+ *==============================================================*/
+template <int Kind, typename I>
+inline void offset_op(I* out, size_t n, I offset, bool stream = false) {
+#ifdef SCAN_SIMD_X86
+  switch( isa() ) {
+  case avx512:
+    if( stream ) offset_op_avx512<Kind, true>(out, n, offset);
+    else offset_op_avx512<Kind, false>(out, n, offset);
+    return;
+  case avx2:
+    if( stream ) offset_op_avx2<Kind, true>(out, n, offset);
+    else offset_op_avx2<Kind, false>(out, n, offset);
+    return;
+  default:
+    break;
+  }
+#endif
+  offset_op_scalar<Kind>(out, n, offset);
+}
+
+/*==============================================================
+ * Selection of the kernels for scan_serial
+ *==============================================================*/
+
+/* Iterator over contiguous storage of value type V (pointer or vector iterator) */
+template <typename It, typename V>
+struct is_contiguous {
+  static const bool value =
+    std::is_same<It, V*>::value || std::is_same<It, const V*>::value ||
+    std::is_same<It, typename std::vector<V>::iterator>::value ||
+    std::is_same<It, typename std::vector<V>::const_iterator>::value;
+};
+
+/* 32-bit and 64-bit integers with an operator of a known kind, read from
+   integers of the same or a narrower type; 64-bit products have no kernel
+   (AVX-512F multiplies 32-bit lanes only) */
+template <typename InIt, typename OutIt, typename Op, typename T>
+struct has_kernel {
+  typedef typename std::iterator_traits<InIt>::value_type in_t;
+  typedef typename std::iterator_traits<OutIt>::value_type out_t;
+  static const int kind = op_kind_of<Op, T>::value;
+  static const bool value =
+    std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+    (sizeof(T) == 4 || sizeof(T) == 8) &&
+    std::is_integral<in_t>::value && !std::is_same<in_t, bool>::value &&
+    sizeof(in_t) <= sizeof(T) && std::is_same<out_t, T>::value &&
+    is_contiguous<InIt, in_t>::value && is_contiguous<OutIt, T>::value &&
+    kind != op_none && !(kind == op_multiplies && sizeof(T) == 8);
+  typedef std::integral_constant<bool, value> type;
+};
+
+} /* namespace simd */
+} /* namespace scan */
+
+#endif /* SCAN_SIMD_H */
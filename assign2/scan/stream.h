@@ -0,0 +1,202 @@
+/*
+ *  scan/stream.h - Out-of-core prefix scan of a file or pipe.
+ */
+
+/*---------------------------------------------------------
+ *  Streaming Prefix Scan
+ *
+ *  The sequence is never held in memory as a whole: it is read in blocks
+ *  of block_size elements, every block is scanned with the backend of the
+ *  policy (in place, seeded with the running total of the preceding
+ *  blocks) and written out.  Three threads form a pipeline over a ring of
+ *  nbuffers >= 2 buffers:
+ *
+ *    reader:  free buffer  -> read(2) a block      -> filled queue
+ *    caller:  filled queue -> scan, advance carry  -> scanned queue
+ *    writer:  scanned queue -> write(2) the block  -> free buffer
+ *
+ *  so that reading block b+1 and writing block b-1 overlap the scan of
+ *  block b.  Descriptors may be pipes; short reads and writes are retried.
+ *  A trailing partial element of the input is ignored.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_STREAM_H
+#define SCAN_STREAM_H
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "serial.h"
+
+namespace scan {
+
+/* Counters of a streaming scan (times in usec); the busiest stage bounds
+   the throughput, scan_wait is the time the scan had nothing to do */
+struct stream_stats {
+  long elements;      /* elements scanned */
+  long blocks;        /* blocks scanned */
+  double read_usec;   /* time spent in read(2) */
+  double scan_usec;   /* time spent scanning */
+  double write_usec;  /* time spent in write(2) */
+  double scan_wait;   /* time the scan waited for a filled buffer */
+
+  stream_stats() : elements(0), blocks(0), read_usec(0), scan_usec(0), write_usec(0),
+                   scan_wait(0) {
+  }
+};
+
+namespace detail {
+
+/*==============================================================
+ * blocking_queue (queue of buffer indices between two stages)
+ *==============================================================*/
+class blocking_queue {
+ public:
+  void push(int value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(value);
+    ready_.notify_one();
+  }
+
+  int pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while( queue_.empty() ) ready_.wait(lock);
+    int value = queue_.front();
+    queue_.pop_front();
+    return value;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<int> queue_;
+};
+
+/* Marks the end of the stream (or an error) in the queues */
+const int end_of_stream = -1;
+
+inline double usec_now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+/*==============================================================
+ * read_full / write_full (transfer exactly bytes unless EOF or
+ *                         an error; return the bytes moved, -1
+ *                         on error)
+ *==============================================================*/
+inline long read_full(int fd, void* buf, size_t bytes) {
+  size_t done = 0;
+  while( done < bytes ) {
+    ssize_t r = read(fd, (char*)buf + done, bytes - done);
+    if( r < 0 && errno == EINTR ) continue;
+    if( r < 0 ) return -1;
+    if( r == 0 ) break;
+    done += r;
+  }
+  return done;
+}
+
+inline long write_full(int fd, const void* buf, size_t bytes) {
+  size_t done = 0;
+  while( done < bytes ) {
+    ssize_t w = write(fd, (const char*)buf + done, bytes - done);
+    if( w < 0 && errno == EINTR ) continue;
+    if( w < 0 ) return -1;
+    done += w;
+  }
+  return done;
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * stream_scan (inclusive prefix scan of the elements of T read
+ *              from in_fd, written to out_fd; false with errno
+ *              set on a read or write error)
+ *==============================================================*/
+template <typename T, typename Policy>
+bool stream_scan(const Policy& policy, int in_fd, int out_fd, long block_size,
+                 int nbuffers = 3, stream_stats* stats = NULL) {
+  if( nbuffers < 2 ) nbuffers = 2;
+
+  std::vector<std::vector<T> > buffers(nbuffers, std::vector<T>(block_size));
+  std::vector<long> counts(nbuffers, 0);
+  detail::blocking_queue free_buffers, filled, scanned;
+  for(int b=0;b<nbuffers;++b) free_buffers.push(b);
+
+  int read_errno = 0, write_errno = 0;
+  stream_stats local;
+
+  /* Reader: fill free buffers until EOF or error */
+  std::thread reader([&]() {
+      for(;;) {
+        int b = free_buffers.pop();
+        if( b == detail::end_of_stream ) break;
+        double t0 = detail::usec_now();
+        long bytes = detail::read_full(in_fd, buffers[b].data(), block_size * sizeof(T));
+        local.read_usec += detail::usec_now() - t0;
+        if( bytes < 0 ) read_errno = errno;
+        counts[b] = bytes > 0 ? bytes / sizeof(T) : 0;
+        if( counts[b] == 0 ) {
+          filled.push(detail::end_of_stream);
+          break;
+        }
+        filled.push(b);
+      }
+    });
+
+  /* Writer: drain scanned buffers, hand them back to the reader */
+  std::thread writer([&]() {
+      for(;;) {
+        int b = scanned.pop();
+        if( b == detail::end_of_stream ) break;
+        double t0 = detail::usec_now();
+        if( write_errno == 0 &&
+            detail::write_full(out_fd, buffers[b].data(), counts[b] * sizeof(T)) < 0 )
+          write_errno = errno;
+        local.write_usec += detail::usec_now() - t0;
+        free_buffers.push(b);
+      }
+    });
+
+  /* Scan the blocks in order, carrying the running total */
+  T carry = T();
+  for(;;) {
+    double t0 = detail::usec_now();
+    int b = filled.pop();
+    double t1 = detail::usec_now();
+    local.scan_wait += t1 - t0;
+    if( b == detail::end_of_stream ) break;
+
+    inclusive_scan_inplace(policy, buffers[b].begin(), buffers[b].begin() + counts[b],
+                           std::plus<T>(), carry);
+    carry = buffers[b][counts[b]-1];
+    local.scan_usec += detail::usec_now() - t1;
+    local.elements += counts[b];
+    local.blocks++;
+
+    scanned.push(b);
+  }
+
+  /* The reader has stopped; the writer stops after the last block */
+  scanned.push(detail::end_of_stream);
+  writer.join();
+  reader.join();
+
+  if( stats ) *stats = local;
+
+  if( read_errno ) errno = read_errno;
+  if( write_errno ) errno = write_errno;
+  return read_errno == 0 && write_errno == 0;
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_STREAM_H */
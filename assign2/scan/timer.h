@@ -0,0 +1,214 @@
+/*
+ *  scan/timer.h - Named per-phase timers of the prefix scan library.
+ */
+
+/*---------------------------------------------------------
+ *  Phase Timers
+ *
+ *  The backends time their phases for every thread that runs them:
+ *
+ *    reduce      totals of blocks, tiles or chunks (reduce-then-scan)
+ *    local_scan  prefix scan of a block, tile, chunk or slice
+ *    exchange    learning the offset: barrier and fold of the block
+ *                totals (OpenMP), look-back, or exchange between processes
+ *    add_back    adding the offset to a block or slice
+ *    total       broadcast of the total (MPI)
+ *
+ *  and the drivers add scatter, gather, read and write.  Times and calls
+ *  accumulate per (thread, phase) until timers_reset(); threads are
+ *  numbered as in their OpenMP team, MPI calls run on thread 0.
+ *
+ *  Timers are off until timers_enable(), and then cost two calls to
+ *  clock_gettime per phase and thread (per tile or chunk for
+ *  decoupled_lookback and dynamic_chunks).
+ *
+ *  print_phase_report writes one CSV line per phase that ran (to a path with
+ *  write_phase_report):
+ *
+ *    phase,workers,calls,min_usec,mean_usec,max_usec,imbalance
+ *
+ *  over the workers that ran it (threads, or the threads of every process
+ *  with the MPI version in scan/mpi.h), in usec per iteration (read,
+ *  gather and write, which the drivers run once, in usec); imbalance is
+ *  max/mean, 1 when perfectly balanced.
+ *---------------------------------------------------------*/
+
+#ifndef SCAN_TIMER_H
+#define SCAN_TIMER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <algorithm>
+
+namespace scan {
+
+enum phase_t { phase_scatter, phase_read, phase_reduce, phase_local_scan, phase_exchange,
+               phase_add_back, phase_total, phase_gather, phase_write, num_phases };
+
+/*==============================================================
+ * phase_name (names used in the reports)
+ *==============================================================*/
+inline const char* phase_name(int phase) {
+  static const char* names[num_phases] = {
+    "scatter", "read", "reduce", "local_scan", "exchange", "add_back", "total", "gather", "write"
+  };
+  return (phase >= 0 && phase < num_phases) ? names[phase] : "unknown";
+}
+
+namespace detail {
+
+const int max_timer_threads = 256;
+
+/* Times of one thread, one cache line apart from the next thread's */
+struct alignas(64) timer_row {
+  double seconds[num_phases];
+  long calls[num_phases];
+};
+
+inline timer_row* timer_rows() {
+  static timer_row rows[max_timer_threads];
+  return rows;
+}
+
+inline bool& timers_on() {
+  static bool on = false;
+  return on;
+}
+
+inline double timer_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+inline void timer_add(phase_t phase, int thread, double seconds) {
+  if( thread < 0 || thread >= max_timer_threads ) return;
+  timer_row& row = timer_rows()[thread];
+  row.seconds[phase] += seconds;
+  ++row.calls[phase];
+}
+
+/*==============================================================
+ * timer_rows_used (rows up to the last thread that timed anything)
+ *==============================================================*/
+inline int timer_rows_used() {
+  const timer_row* rows = timer_rows();
+  int nrows = 0;
+  for(int i=0;i<max_timer_threads;++i)
+    for(int p=0;p<num_phases;++p)
+      if( rows[i].calls[p] ) nrows = i + 1;
+  return nrows;
+}
+
+/*==============================================================
+ * write_phase_report (CSV statistics of the rows, per iteration)
+ *==============================================================*/
+inline void write_phase_report(FILE* f, const timer_row* rows, int nrows, double niterations) {
+  if( niterations <= 0 ) niterations = 1;
+  fprintf(f, "phase,workers,calls,min_usec,mean_usec,max_usec,imbalance\n");
+  for(int p=0;p<num_phases;++p) {
+    bool once = p == phase_read || p == phase_gather || p == phase_write;
+    int workers = 0;
+    long calls = 0;
+    double lo = 0, hi = 0, sum = 0;
+    for(int i=0;i<nrows;++i) {
+      if( !rows[i].calls[p] ) continue;
+      double usec = rows[i].seconds[p] * 1e6 / (once ? 1.0 : niterations);
+      lo = workers ? std::min(lo, usec) : usec;
+      hi = workers ? std::max(hi, usec) : usec;
+      sum += usec;
+      calls += rows[i].calls[p];
+      ++workers;
+    }
+    if( !workers ) continue;
+    double mean = sum / workers;
+    fprintf(f, "%s,%d,%ld,%.3f,%.3f,%.3f,%.3f\n", phase_name(p), workers, calls, lo, mean, hi,
+            mean > 0 ? hi / mean : 1.0);
+  }
+}
+
+} /* namespace detail */
+
+/*==============================================================
+ * timers_enable / timers_enabled / timers_reset
+ *==============================================================*/
+inline void timers_enable(bool on = true) {
+  detail::timers_on() = on;
+}
+
+inline bool timers_enabled() {
+  return detail::timers_on();
+}
+
+inline void timers_reset() {
+  memset(detail::timer_rows(), 0, detail::max_timer_threads * sizeof(detail::timer_row));
+}
+
+/*==============================================================
+ * phase_timer (times its scope as a phase of a thread)
+ *==============================================================*/
+class phase_timer {
+ public:
+  explicit phase_timer(phase_t phase, int thread = 0)
+    : phase_(phase), thread_(thread), start_(detail::timers_on() ? detail::timer_now() : -1.0) {
+  }
+
+  ~phase_timer() {
+    if( start_ >= 0.0 ) detail::timer_add(phase_, thread_, detail::timer_now() - start_);
+  }
+
+ private:
+  phase_timer(const phase_timer&);
+  phase_timer& operator=(const phase_timer&);
+
+  phase_t phase_;
+  int thread_;
+  double start_;
+};
+
+/*==============================================================
+ * print_phase_report (statistics over the threads of this
+ *                     process, times divided by niterations)
+ *==============================================================*/
+inline void print_phase_report(FILE* f, double niterations) {
+  detail::write_phase_report(f, detail::timer_rows(), detail::timer_rows_used(), niterations);
+}
+
+/*==============================================================
+ * write_phase_report (print_phase_report to path, "-" for stdout)
+ *==============================================================*/
+inline void write_phase_report(const char* path, double niterations) {
+  FILE* f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+  if( !f ) {
+    perror(path);
+    return;
+  }
+  print_phase_report(f, niterations);
+  if( f != stdout ) fclose(f);
+}
+
+/*==============================================================
+ * elapsed (usec between two gettimeofday times; end is
+ *          normalized in place)
+ *==============================================================*/
+inline long elapsed(struct timeval* start, struct timeval* end) {
+  if( start->tv_usec > end->tv_usec ) {
+    end->tv_usec += 1000000;
+    end->tv_sec--;
+  }
+  return (end->tv_sec - start->tv_sec) * 1000000L + (end->tv_usec - start->tv_usec);
+}
+
+/*==============================================================
+ * print_elapsed (prints the usec per iteration of niters)
+ *==============================================================*/
+inline void print_elapsed(const char* desc, struct timeval* start, struct timeval* end,
+                          int niters) {
+  printf("\n %s total elapsed time = %ld (usec)", desc, elapsed(start, end) / niters);
+}
+
+} /* namespace scan */
+
+#endif /* SCAN_TIMER_H */
@@ -0,0 +1,265 @@
+/*
+ *  scan_bench.cpp - Compares the algorithms of the OpenMP prefix scan.
+ *  This program uses OpenMP.
+ */
+
+/*---------------------------------------------------------
+ *  Prefix Sum Benchmark
+ *
+ *  1. Generate numints random integers
+ *  2. For every algorithm, compute the prefix sum numiterations times,
+ *     out of place and then in place, and report the mean time, the
+ *     effective bandwidth and whether the result matches std::partial_sum
+ *  3. Scan with other operators of scan/monoid.h (same SIMD kernels)
+ *  4. Compute a segmented prefix sum (segments of seglen elements) in one
+ *     call, from flags and from offsets, and with one call per segment
+ *
+ *  The effective bandwidth counts the minimum traffic of a scan: one read
+ *  of the input and one write of the output per element.
+ *---------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <omp.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include "scan/scan.h"
+#include "scan/random.h"
+using namespace std;
+
+/*==============================================================
+ * compute elapsed time between start and end
+ *==============================================================*/
+long elapsed(struct timeval *start, struct timeval *end) {
+  struct timeval elapsed;
+  /* calculate elapsed time */
+  if(start->tv_usec > end->tv_usec) {
+    end->tv_usec += 1000000;
+    end->tv_sec--;
+  }
+  elapsed.tv_usec = end->tv_usec - start->tv_usec;
+  elapsed.tv_sec  = end->tv_sec  - start->tv_sec;
+  return elapsed.tv_sec*1000000 + elapsed.tv_usec;
+}
+
+/*==============================================================
+ * run_case (times one scan variant and checks its result;
+ *           prepare runs untimed before every scan, in_bytes
+ *           is the size of an input element, mismatch is
+ *           printed if the result differs)
+ *==============================================================*/
+template <typename T, typename Prepare, typename Scan>
+void run_case(const string& name, Prepare prepare, Scan scan_once,
+              const vector<T>& result_gold, vector<T>& prefix_sums, int numiterations,
+              int in_bytes = sizeof(T), const char* mismatch = "FAILED") {
+  struct timeval start, end;
+  struct timezone tzp;
+
+  /* clear the previous result, then warm up */
+  std::fill(prefix_sums.begin(), prefix_sums.end(), T(0));
+  prepare();
+  scan_once();
+
+  long totalTime = 0;
+  for(int iteration=0; iteration < numiterations; ++iteration) {
+    prepare();
+    gettimeofday(&start, &tzp);
+    scan_once();
+    gettimeofday(&end, &tzp);
+    totalTime += elapsed(&start, &end);
+  }
+
+  double usec = totalTime / (double)numiterations;
+  double gbps = (double)(in_bytes + sizeof(T)) * result_gold.size() / (usec * 1e3);
+  bool passed = std::equal(result_gold.begin(), result_gold.end(), prefix_sums.begin());
+
+  printf("%-28s %12.1f %10.2f   %s\n", name.c_str(), usec, gbps, passed ? "PASSED" : mismatch);
+}
+
+/*==============================================================
+ * run_operator (times an out-of-place scan with op, checked
+ *               against std::partial_sum with op)
+ *==============================================================*/
+template <typename Op>
+void run_operator(const string& name, const scan::openmp& policy, Op op,
+                  const vector<long>& data, vector<long>& prefix_sums, int numiterations) {
+  vector<long> result_gold(data.size());
+  std::partial_sum(data.begin(), data.end(), result_gold.begin(), op);
+  run_case(name, []() {}, [&]() {
+      scan::inclusive_scan(policy, data.begin(), data.end(), prefix_sums.begin(), op,
+                           scan::identity<long>(op));
+    }, result_gold, prefix_sums, numiterations);
+}
+
+/*==============================================================
+ * run_widening (times a sum of narrow In elements into longs,
+ *               checked against the same sum of long elements)
+ *==============================================================*/
+template <typename In>
+void run_widening(const string& name, const scan::openmp& policy, const vector<long>& data,
+                  vector<long>& prefix_sums, int numiterations) {
+  vector<In> narrow(data.size());
+  for(size_t i=0;i<data.size();++i) narrow[i] = (In)data[i];
+  vector<long> result_gold(narrow.begin(), narrow.end());
+  std::partial_sum(result_gold.begin(), result_gold.end(), result_gold.begin());
+  run_case(name, []() {}, [&]() {
+      scan::inclusive_scan(policy, narrow.begin(), narrow.end(), prefix_sums.begin(),
+                           std::plus<long>(), 0L);
+    }, result_gold, prefix_sums, numiterations, sizeof(In));
+}
+
+/*==============================================================
+ *  Main Program
+ *==============================================================*/
+int main(int argc, char *argv[]) {
+
+  if( argc < 4 ) {
+    printf("Usage: %s [numprocs] [numints] [numiterations] [seglen]\n\n", argv[0]);
+    exit(1);
+  }
+
+  int numprocs      = atoi(argv[1]);
+  int numints       = atoi(argv[2]);
+  int numiterations = atoi(argv[3]);
+  int seglen        = argc > 4 ? atoi(argv[4]) : 1000;
+  if( seglen <= 0 ) seglen = 1000;
+
+  printf("\nExecuting %s: nthreads=%d, numints=%d, numiterations=%d, simd=%s, llc=%ld\n\n",
+         argv[0], numprocs, numints, numiterations,
+         scan::simd::isa_name(scan::simd::isa()), scan::simd::llc_bytes());
+
+  vector<long> data(numints);
+  vector<long> prefix_sums(numints);
+  vector<long> result_gold(numints);
+
+  scan::random_ints(1, 0, data.data(), data.size());
+  std::partial_sum(data.begin(), data.end(), result_gold.begin());
+
+  printf("%-28s %12s %10s   %s\n", "algorithm", "time(usec)", "GB/s", "check");
+
+  const scan::openmp::algorithm_t algorithms[] = {
+    scan::openmp::scan_then_propagate, scan::openmp::reduce_then_scan,
+    scan::openmp::decoupled_lookback, scan::openmp::dynamic_chunks
+  };
+  const int nalgorithms = sizeof(algorithms) / sizeof(algorithms[0]);
+  auto nothing = []() {};
+
+  /* out of place: data is read once, prefix_sums written once */
+  for(int a=0;a<nalgorithms;++a) {
+    scan::openmp policy(numprocs, algorithms[a]);
+    run_case(scan::algorithm_name(algorithms[a]), nothing, [&]() {
+        scan::inclusive_scan(policy, data.begin(), data.end(), prefix_sums.begin(),
+                             std::plus<long>(), 0L);
+      }, result_gold, prefix_sums, numiterations);
+  }
+
+  /* in place: prefix_sums is refilled with the input (untimed) before every scan */
+  for(int a=0;a<nalgorithms;++a) {
+    scan::openmp policy(numprocs, algorithms[a]);
+    run_case(string(scan::algorithm_name(algorithms[a])) + "/inplace", [&]() {
+        std::copy(data.begin(), data.end(), prefix_sums.begin());
+      }, [&]() {
+        scan::inclusive_scan_inplace(policy, prefix_sums.begin(), prefix_sums.end(),
+                                     std::plus<long>(), 0L);
+      }, result_gold, prefix_sums, numiterations);
+  }
+
+  /* exclusive: out[i] is the sum of data[0..i), written by the same kernels */
+  vector<long> exclusive_gold(numints);
+  if( numints > 0 ) {
+    exclusive_gold[0] = 0;
+    std::copy(result_gold.begin(), result_gold.end() - 1, exclusive_gold.begin() + 1);
+  }
+  for(int a=0;a<nalgorithms;++a) {
+    scan::openmp policy(numprocs, algorithms[a]);
+    run_case(string(scan::algorithm_name(algorithms[a])) + "/exclusive", nothing, [&]() {
+        scan::exclusive_scan(policy, data.begin(), data.end(), prefix_sums.begin(),
+                             std::plus<long>(), 0L);
+      }, exclusive_gold, prefix_sums, numiterations);
+  }
+
+  /* stores of the output, automatic above picks streaming past the LLC size */
+  run_case("reduce_then_scan/regular", nothing, [&]() {
+      scan::inclusive_scan(scan::openmp(numprocs, scan::openmp::reduce_then_scan, 0,
+                                        scan::store_regular),
+                           data.begin(), data.end(), prefix_sums.begin(), std::plus<long>(), 0L);
+    }, result_gold, prefix_sums, numiterations);
+
+  run_case("reduce_then_scan/stream", nothing, [&]() {
+      scan::inclusive_scan(scan::openmp(numprocs, scan::openmp::reduce_then_scan, 0,
+                                        scan::store_streaming),
+                           data.begin(), data.end(), prefix_sums.begin(), std::plus<long>(), 0L);
+    }, result_gold, prefix_sums, numiterations);
+
+  /* other operators on long: one kernel per instruction set serves minimum,
+     maximum and bit_xor; there is no 64-bit SIMD multiply, product is scalar */
+  scan::openmp dynamic(numprocs, scan::openmp::dynamic_chunks);
+  run_operator("dynamic_chunks/minimum", dynamic, scan::minimum<long>(), data, prefix_sums,
+               numiterations);
+  run_operator("dynamic_chunks/maximum", dynamic, scan::maximum<long>(), data, prefix_sums,
+               numiterations);
+  run_operator("dynamic_chunks/bit_xor", dynamic, scan::bit_xor<long>(), data, prefix_sums,
+               numiterations);
+  run_operator("dynamic_chunks/product(scalar)", dynamic, scan::product<long>(), data, prefix_sums,
+               numiterations);
+
+  /* narrow input, long sums: fewer bytes read per element (input truncated to In) */
+  run_widening<int32_t>("dynamic_chunks/int32->long", dynamic, data, prefix_sums, numiterations);
+  run_widening<uint16_t>("dynamic_chunks/uint16->long", dynamic, data, prefix_sums, numiterations);
+  run_widening<uint8_t>("dynamic_chunks/uint8->long", dynamic, data, prefix_sums, numiterations);
+
+  /* doubles: the check is bitwise equality with one thread, which only the
+     reproducible scan guarantees for any number of threads; the plain scan
+     is timed as the baseline of its overhead */
+  vector<double> values(numints), double_sums(numints), double_gold(numints);
+  for(int i=0;i<numints;++i) values[i] = (data[i] - 1073741824.0) * 1e-3;
+  scan::inclusive_scan(scan::openmp(1, scan::openmp::reduce_then_scan), values.begin(),
+                       values.end(), double_gold.begin(), std::plus<double>(), 0.0);
+  run_case("double/plain", nothing, [&]() {
+      scan::inclusive_scan(scan::openmp(numprocs, scan::openmp::reduce_then_scan),
+                           values.begin(), values.end(), double_sums.begin(),
+                           std::plus<double>(), 0.0);
+    }, double_gold, double_sums, numiterations, sizeof(double), "differs (expected)");
+
+  scan::reproducible_inclusive_scan(scan::serial(), values.begin(), values.end(),
+                                    double_gold.begin());
+  run_case("double/reproducible", nothing, [&]() {
+      scan::reproducible_inclusive_scan(scan::openmp(numprocs), values.begin(), values.end(),
+                                        double_sums.begin());
+    }, double_gold, double_sums, numiterations);
+
+  /* segmented: the sum restarts every seglen elements (like CSR rows) */
+  vector<unsigned char> flags(numints, 0);
+  vector<long> offsets;
+  vector<long> segment_gold(numints);
+  for(long i=0;i<numints;i+=seglen) {
+    flags[i] = 1;
+    offsets.push_back(i);
+    std::partial_sum(data.begin() + i, data.begin() + std::min<long>(i + seglen, numints),
+                     segment_gold.begin() + i);
+  }
+  offsets.push_back(numints);
+
+  scan::openmp policy(numprocs);
+  run_case("segmented/flags", nothing, [&]() {
+      scan::segmented_inclusive_scan(policy, data.begin(), data.end(), flags.begin(),
+                                     prefix_sums.begin(), std::plus<long>(), 0L);
+    }, segment_gold, prefix_sums, numiterations);
+
+  run_case("segmented/offsets", nothing, [&]() {
+      scan::segmented_inclusive_scan(policy, data.begin(), data.end(), offsets.begin(),
+                                     offsets.end(), prefix_sums.begin(), std::plus<long>(), 0L);
+    }, segment_gold, prefix_sums, numiterations);
+
+  run_case("segmented/call_per_segment", nothing, [&]() {
+      for(size_t s=0;s+1<offsets.size();++s)
+        scan::inclusive_scan(policy, data.begin() + offsets[s], data.begin() + offsets[s+1],
+                             prefix_sums.begin() + offsets[s], std::plus<long>(), 0L);
+    }, segment_gold, prefix_sums, numiterations);
+
+  return(0);
+}